@@ -0,0 +1,27 @@
+#ifndef COLOR_CACHE_HPP_INCLUDED
+#define COLOR_CACHE_HPP_INCLUDED
+
+/*
+ * cache : decoded images shared between conversions
+ *
+ *   models converted together often share textures, so decoded images can be
+ *   kept (up to a budget, least recently used out first) and handed out by path --
+ *   concurrent requests for an image that's still being decoded wait for it
+ */
+#include <color/decode.hpp>
+
+namespace color {
+
+// keep up to this many bytes of decoded pixels (0, the default, keeps nothing)
+void setImageCache(size_t bytes);
+
+// read an image through the cache (with no cache, this is just 'read')
+void readCached(const std::string& filename, image& out);
+
+// how many reads the cache has saved, and how many it couldn't
+size_t imageCacheHits();
+size_t imageCacheMisses();
+
+}
+
+#endif
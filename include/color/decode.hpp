@@ -0,0 +1,47 @@
+#ifndef COLOR_DECODE_HPP_INCLUDED
+#define COLOR_DECODE_HPP_INCLUDED
+
+/*
+ * decode : read image files into flat RGBA pixel buffers
+ *
+ *   PNG, TGA and PPM/PGM files are decoded natively, anything else
+ *   goes through ImageMagick (which is only initialized on first use)
+ */
+#include <color/data.hpp>
+#include <string>
+#include <vector>
+
+namespace color {
+
+// pixels are stored row-major, top row first
+typedef std::vector<value> pixels;
+
+struct image {
+	unsigned int width;
+	unsigned int height;
+	pixels       data;
+
+	image();
+};
+
+// decode an image file with whatever decoder understands it
+void read(const std::string& filename, image& out);
+
+// decode an image file natively -- returns false if the format isn't natively supported
+bool decode(const std::string& filename, image& out);
+
+bool decodePNG(const std::vector<unsigned char>& bytes, image& out);
+bool decodeTGA(const std::vector<unsigned char>& bytes, image& out);
+bool decodePNM(const std::vector<unsigned char>& bytes, image& out);
+
+// decode an image file through ImageMagick
+void readMagick(const std::string& filename, image& out);
+
+// ImageMagick is initialized lazily, the first time that it's actually needed
+void deferMagickInit(const char* progpath);
+void initMagick();
+double magickInitTime(); // milliseconds spent initializing ImageMagick (0 if never needed)
+
+}
+
+#endif
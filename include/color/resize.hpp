@@ -0,0 +1,29 @@
+#ifndef COLOR_RESIZE_HPP_INCLUDED
+#define COLOR_RESIZE_HPP_INCLUDED
+
+/*
+ * resize : box-filter images down to a smaller size
+ *
+ *   each destination pixel is the average of the source pixels under it (and
+ *   every box covers at least one pixel, so enlarging just samples the source)
+ */
+#include <color/decode.hpp>
+#include <algorithm>
+
+namespace color {
+
+// the source range [s0, s1) under destination pixel i of n (out of sn source pixels)
+inline void box(unsigned int i, unsigned int n, unsigned int sn, unsigned int& s0, unsigned int& s1) {
+	s0 = (unsigned int)((unsigned long long)i * sn / n);
+	s1 = std::max(s0 + 1, (unsigned int)((unsigned long long)(i + 1) * sn / n));
+}
+
+// resample rows [y0, y1) of a w x h version of 'src' into 'out' (which starts at row y0)
+void boxFilter(const image& src, unsigned int w, unsigned int h, unsigned int y0, unsigned int y1, value* out);
+
+// resample a whole image (rows are filtered in parallel)
+void resize(const image& src, unsigned int w, unsigned int h, image& out);
+
+}
+
+#endif
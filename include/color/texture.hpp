@@ -2,7 +2,7 @@
 #define COLOR_TEXTURE_HPP_INCLUDED
 
 #include <color/data.hpp>
-#include <Magick++.h>
+#include <color/decode.hpp>
 #include <string>
 
 namespace color {
@@ -14,16 +14,20 @@ public:
 
 	void load(const std::string& filename);
 
+	// materials without an image map just have a constant (diffuse) color
+	void fill(color::value c);
+	bool flat() const;
+	color::value flatColor() const;
+
 	unsigned int width() const;
 	unsigned int height() const;
 
 	color::value texel(double u, double v) const;
 	color::value texel(int tx, int ty) const;
 private:
-	Magick::Image image;
-	unsigned int  cx, cy;
-
-	const Magick::PixelPacket* pixels;
+	unsigned int cx, cy;
+	pixels       texels;
+	color::value kd;
 };
 
 }
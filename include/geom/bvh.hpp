@@ -0,0 +1,67 @@
+#ifndef GEOM_BVH_HPP_INCLUDED
+#define GEOM_BVH_HPP_INCLUDED
+
+/*
+ * bvh : a bounding volume hierarchy over a set of triangles
+ *
+ *   besides box queries, this answers "how inside is this point?" for meshes
+ *   that aren't closed, with the generalized winding number (the sum of the
+ *   solid angles of the triangles, over 4pi) -- clusters of triangles far from
+ *   the query point are approximated by their area-weighted normal (a dipole),
+ *   so only nearby triangles are summed exactly
+ */
+#include <geom/triset.hpp>
+#include <vector>
+
+namespace geom {
+
+struct box {
+	double x0, y0, z0;
+	double x1, y1, z1;
+
+	box();
+	box(double x0, double y0, double z0, double x1, double y1, double z1);
+
+	void add(const point& p);
+	void add(const box& b);
+	bool overlaps(const box& b) const;
+};
+
+class bvh {
+public:
+	bvh(const std::vector<triangle>& tris);
+
+	// ~1 inside a closed (consistently wound) mesh, ~0 outside, and in between near holes
+	double winding(double x, double y, double z) const;
+
+	// true if some triangle's bounding box overlaps 'b'
+	bool overlaps(const box& b) const;
+private:
+	struct node {
+		box          bounds;
+		unsigned int first;  // triangles [first, first+count) (in 'order') for leaves
+		unsigned int count;
+		unsigned int right;  // for inner nodes, the left child is the next node
+
+		// the cluster's dipole: area-weighted centroid and normal, and a radius about it
+		double cx, cy, cz;
+		double nx, ny, nz;
+		double radius;
+	};
+	typedef std::vector<node> nodes;
+
+	const std::vector<triangle>& tris;
+	std::vector<unsigned int>    order;
+	nodes                        ns;
+
+	unsigned int build(unsigned int first, unsigned int count);
+	double winding(unsigned int n, double x, double y, double z) const;
+	bool overlaps(unsigned int n, const box& b) const;
+
+	bvh(const bvh&);
+	bvh& operator=(const bvh&);
+};
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef GEOM_DOWNSAMPLE_HPP_INCLUDED
+#define GEOM_DOWNSAMPLE_HPP_INCLUDED
+
+#include <geom/voxel.hpp>
+#include <vector>
+
+namespace geom {
+
+// a coarser copy of a volume, made once up front (slabs are filtered in parallel)
+//
+//   each voxel covers a box of source voxels, and is occupied if at least 'minFill'
+//   of them are -- its color only averages the occupied ones, so thin surfaces
+//   survive and colors aren't washed out by the empty space around them
+class downsample : public volume {
+public:
+	downsample(const volume& v, unsigned int w, unsigned int h, unsigned int d, unsigned int minFill = 1);
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+private:
+	unsigned int              w;
+	unsigned int              h;
+	unsigned int              d;
+	std::vector<color::value> data; // y slabs, each a series of z rows
+};
+
+}
+
+#endif
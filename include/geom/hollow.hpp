@@ -0,0 +1,37 @@
+#ifndef GEOM_HOLLOW_HPP_INCLUDED
+#define GEOM_HOLLOW_HPP_INCLUDED
+
+#include <geom/voxel.hpp>
+#include <par/progress.hpp>
+#include <vector>
+
+namespace geom {
+
+// a volume with everything deeper than 'thickness' voxels inside of it emptied out
+//
+//   depth is the exact euclidean distance to the nearest empty voxel (or the edge of
+//   the volume), found up front by a separable distance transform -- one linear pass
+//   along each axis, with the lines of each pass spread over threads by slab
+class hollow : public volume {
+public:
+	hollow(const volume& v, unsigned int thickness, par::progress* prog = 0);
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+	void rowSpans(unsigned int y, unsigned int z, spans& out) const;
+private:
+	const volume&             v;
+	unsigned int              maxDistSq;
+	std::vector<unsigned int> distSq; // (0 where empty) y slabs, each a series of z rows
+
+	bool kept(unsigned int x, unsigned int y, unsigned int z) const;
+};
+
+}
+
+#endif
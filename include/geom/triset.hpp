@@ -27,6 +27,10 @@ struct triangle {
 	triangle operator-(const point& rhs) const;
 	color::value color(double u, double v) const;
 
+	// true if this triangle has one constant color (so needs no texture sampling)
+	bool flat() const;
+	color::value flatColor() const;
+
 	void scale(double sx, double sy, double sz);
 };
 
@@ -2,9 +2,20 @@
 #define GEOM_VOXEL_HPP_INCLUDED
 
 #include <color/data.hpp>
+#include <vector>
 
 namespace geom {
 
+// a run of non-empty voxels along the x axis
+struct span {
+	unsigned int x;
+	unsigned int n;
+
+	span(unsigned int x = 0, unsigned int n = 0);
+};
+typedef std::vector<span> spans;
+
+// a box of colored voxels (exporters may read voxels from several threads at once)
 struct volume {
 	virtual unsigned int width()  const = 0;
 	virtual unsigned int height() const = 0;
@@ -12,9 +23,61 @@ struct volume {
 
 	virtual color::value voxel(unsigned int x, unsigned int y, unsigned int z) const = 0;
 
+	// bulk access (by default, through 'voxel')
+	//   readRow  : the n voxels from (x, y, z) along the x axis
+	//   readSlab : the whole y slab, as out[x + width() * z]
+	//   rowSpans : the non-empty (not entirely transparent) runs of the (y, z) row
+	virtual void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+	virtual void readSlab(unsigned int y, color::value* out) const;
+	virtual void rowSpans(unsigned int y, unsigned int z, spans& out) const;
+
 	virtual ~volume();
 };
 
+// read the n voxels from (x, y, z) along the x axis out of a w x h x d volume stored densely,
+// as y slabs of z rows (voxels past the edge of the volume are empty)
+void readDenseRow(const color::value* data, unsigned int w, unsigned int h, unsigned int d, unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out);
+
+// a box within another volume
+class subvolume : public volume {
+public:
+	subvolume(const volume& v, unsigned int x0, unsigned int y0, unsigned int z0, unsigned int w, unsigned int h, unsigned int d);
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+	void rowSpans(unsigned int y, unsigned int z, spans& out) const;
+private:
+	const volume& v;
+	unsigned int  x0, y0, z0;
+	unsigned int  w, h, d;
+};
+
+// iterate over the non-empty runs of a volume, row by row (in y, z order), skipping empty rows
+class runs {
+public:
+	runs(const volume& v);
+
+	bool done() const;
+	void operator++();
+
+	// the current run is 'point().n' voxels from (point().x, y(), z())
+	const span& point() const;
+	unsigned int y() const;
+	unsigned int z() const;
+private:
+	const volume& v;
+	unsigned int  ry, rz;
+	spans         row;
+	unsigned int  i;
+
+	void seek();
+};
+
 }
 
 #endif
@@ -0,0 +1,25 @@
+#ifndef IO_DEFLATE_HPP_INCLUDED
+#define IO_DEFLATE_HPP_INCLUDED
+
+/*
+ * deflate : compression settings for gzip output
+ */
+#include <string>
+#include <zlib.h>
+
+namespace io {
+
+struct deflate_options {
+	int level;    // 0 (stored) - 9 (smallest), or Z_DEFAULT_COMPRESSION
+	int strategy; // Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE or Z_FIXED
+
+	deflate_options(int level = Z_DEFAULT_COMPRESSION, int strategy = Z_DEFAULT_STRATEGY) : level(level), strategy(strategy) {
+	}
+};
+
+// read a strategy by name (default, filtered, huffman, rle or fixed)
+int deflateStrategy(const std::string& name);
+
+}
+
+#endif
@@ -1,15 +1,27 @@
-
 #ifndef GZIPSTREAM_H_INCLUDED
 #define GZIPSTREAM_H_INCLUDED
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <vector>
 #include <stdexcept>
+#include <string.h>
 #include <zlib.h>
+#include <io/deflate.hpp>
 
 namespace io {
 
+// the default size of gzip stream buffers (1MB)
+inline size_t default_gzip_buffer_size() {
+	return 1024 * 1024;
+}
+
+// zlib's own (compressed-side) buffer tracks ours, within reason
+inline unsigned int zlib_buffer_size(size_t n) {
+	return (unsigned int)std::min(std::max(n, size_t(8 * 1024)), size_t(64 * 1024 * 1024));
+}
+
 // read gz files
 template < typename Char = char, typename Traits = std::char_traits<Char> >
 class gzip_istream_buffer : public std::basic_streambuf<Char, Traits> {
@@ -18,47 +30,91 @@ public:
     typedef typename std::basic_streambuf<Char, Traits>::char_type char_type;
     typedef typename std::basic_streambuf<Char, Traits> BaseT;
 
-    gzip_istream_buffer(const std::string& fname) {
-		this->file = gzopen(fname.c_str(), "r");
+    gzip_istream_buffer(const std::string& fname, size_t bufferSize = default_gzip_buffer_size()) : input(bufferSize > 0 ? bufferSize : 1) {
+		this->file = gzopen(fname.c_str(), "rb");
 		if (this->file == 0) {
 			throw std::runtime_error("Unable to open the gzip file '" + fname + "' for reading.");
 		}
+		gzbuffer(this->file, zlib_buffer_size(bufferSize * sizeof(Char)));
 
-	    setg((Char*)0, (Char*)0, (Char*)0);
+	    BaseT::setg(begin(), begin(), begin());
     }
 
     ~gzip_istream_buffer() {
 		gzclose(this->file);
     }
+
+	size_t buffer_size() const {
+		return this->input.size();
+	}
 private:
     typedef typename std::vector<Char> BufferT;
 
 	gzFile  file;
     BufferT input;
 
+	Char* begin() {
+		return &(*(this->input.begin()));
+	}
+
+	// gzread/gzwrite take 'unsigned' byte counts, so huge requests go through in pieces
+	static unsigned int chunk_size(size_t n) {
+		return (unsigned int)((n < size_t(1 << 30)) ? n : size_t(1 << 30));
+	}
+
+	// read up to n characters straight from the file, returns the number read
+	std::streamsize fill(Char* dst, std::streamsize n) {
+		std::streamsize total = 0;
+		while (total < n) {
+			int rret = gzread(this->file, dst + total, chunk_size(size_t(n - total) * sizeof(Char)));
+			if (rret < 0) {
+				throw std::runtime_error("Failed to read from gzip file.");
+			} else if (rret == 0) {
+				break;
+			}
+			total += rret / sizeof(Char);
+		}
+		return total;
+	}
+
     int_type underflow() {
         if (BaseT::gptr() != BaseT::egptr()) {
             return Traits::to_int_type(*BaseT::gptr());
-		} else if (gzeof(this->file)) {
-			return Traits::eof();
 		}
 
-        input.clear();
-        input.resize(2048);
+		std::streamsize n = fill(begin(), this->input.size());
+		BaseT::setg(begin(), begin(), begin() + n);
 
-        int rret = 0;
-
-		rret = gzread(this->file, &(*(input.begin())), input.size() * sizeof(Char));
-		input.resize(rret);
-
-		if (input.size() == 0) {
+		if (n == 0) {
 			return Traits::eof();
 		} else {
-			setg(&(*(input.begin())), &(*(input.begin())), &(*(input.begin() + input.size())));
-			return Traits::to_int_type(*(input.begin()));
+			return Traits::to_int_type(*begin());
 		}
     }
 
+	// bulk reads drain the get area, then bypass it for anything at least as big as the buffer
+	std::streamsize xsgetn(Char* dst, std::streamsize n) {
+		std::streamsize total = 0;
+
+		while (total < n) {
+			std::streamsize avail = BaseT::egptr() - BaseT::gptr();
+			if (avail > 0) {
+				std::streamsize k = std::min(avail, n - total);
+				Traits::copy(dst + total, BaseT::gptr(), k);
+				BaseT::gbump(int(k));
+				total += k;
+			} else if (n - total >= std::streamsize(this->input.size())) {
+				std::streamsize k = fill(dst + total, n - total);
+				if (k == 0) break;
+				total += k;
+			} else if (Traits::eq_int_type(underflow(), Traits::eof())) {
+				break;
+			}
+		}
+
+		return total;
+	}
+
 	gzip_istream_buffer();
 	gzip_istream_buffer(const gzip_istream_buffer<Char, Traits>& rhs);
 	void operator=(const gzip_istream_buffer<Char, Traits>& rhs);
@@ -67,7 +123,7 @@ private:
 template < typename Char = char, typename Traits = std::char_traits<Char> >
 class gzip_istream : public std::basic_istream<Char, Traits> {
 public:
-    gzip_istream(const std::string& fname) : std::basic_istream<Char, Traits>(&buffer), buffer(fname) {
+    gzip_istream(const std::string& fname, size_t bufferSize = default_gzip_buffer_size()) : std::basic_istream<Char, Traits>(&buffer), buffer(fname, bufferSize) {
     }
 private:
     typedef gzip_istream_buffer<Char, Traits> Buffer;
@@ -86,47 +142,116 @@ public:
     typedef typename std::basic_streambuf<Char, Traits>::char_type char_type;
     typedef typename std::basic_streambuf<Char, Traits> BaseT;
 
-    gzip_ostream_buffer(const std::string& fname) {
-		this->file = gzopen(fname.c_str(), "w");
+    gzip_ostream_buffer(const std::string& fname, size_t bufferSize = default_gzip_buffer_size(), const deflate_options& z = deflate_options()) : fname(fname), output(bufferSize > 0 ? bufferSize : 1) {
+		this->file = gzopen(fname.c_str(), "wb");
 		if (this->file == 0) {
 			throw std::runtime_error("Unable to open the gzip file '" + fname + "' for writing.");
 		}
+		gzbuffer(this->file, zlib_buffer_size(bufferSize * sizeof(Char)));
+		if (gzsetparams(this->file, z.level, z.strategy) != Z_OK) {
+			gzclose(this->file);
+			throw std::runtime_error("Invalid compression level/strategy for the gzip file '" + fname + "'.");
+		}
+
+		BaseT::setp(begin(), begin() + this->output.size());
     }
 
+    // (closing explicitly reports failures -- this is only a best-effort fallback)
     ~gzip_ostream_buffer() {
-		sync();
-		gzclose(this->file);
+		try {
+			close();
+		} catch (...) {
+		}
+		if (this->file) {
+			gzclose(this->file);
+		}
     }
 
-	unsigned int max_buffer_size() const {
-		return 4 * 1024; // 4k
+	// write everything still buffered and finish the gzip stream
+	void close() {
+		if (this->file == 0) {
+			return;
+		}
+
+		sync();
+
+		gzFile f = this->file;
+		this->file = 0;
+		if (gzclose(f) != Z_OK) {
+			throw std::runtime_error("Failed to finish writing the gzip file '" + this->fname + "'.");
+		}
+	}
+
+	size_t buffer_size() const {
+		return this->output.size();
 	}
 private:
 	typedef typename std::vector<Char> BufferT;
 
-	gzFile  file;
-	BufferT output;
+	std::string fname;
+	gzFile      file; // (0 once closed)
+	BufferT     output;
+
+	Char* begin() {
+		return &(*(this->output.begin()));
+	}
+
+	static unsigned int chunk_size(size_t n) {
+		return (unsigned int)((n < size_t(1 << 30)) ? n : size_t(1 << 30));
+	}
+
+	// write n characters straight to the file
+	void drain(const Char* src, std::streamsize n) {
+		if (this->file == 0 && n > 0) {
+			throw std::runtime_error("Can't write to the closed gzip file '" + this->fname + "'.");
+		}
+		while (n > 0) {
+			unsigned int k = chunk_size(size_t(n) * sizeof(Char));
+			if (gzwrite(this->file, src, k) == 0) {
+				throw std::runtime_error("Failed to write buffer to the gzip file '" + this->fname + "'.");
+			}
+			src += k / sizeof(Char);
+			n   -= k / sizeof(Char);
+		}
+	}
 
 	int_type overflow(int_type c) {
-		if (c == Traits::eof()) {
+		sync();
+
+		if (!Traits::eq_int_type(c, Traits::eof())) {
+			*BaseT::pptr() = Traits::to_char_type(c);
+			BaseT::pbump(1);
+		}
+
+		return Traits::not_eof(c);
+	}
+
+	// bulk writes fill the put area, and skip it entirely for anything at least as big as the buffer
+	std::streamsize xsputn(const Char* src, std::streamsize n) {
+		std::streamsize room = BaseT::epptr() - BaseT::pptr();
+
+		if (n <= room) {
+			Traits::copy(BaseT::pptr(), src, n);
+			BaseT::pbump(int(n));
+		} else if (n >= std::streamsize(this->output.size())) {
 			sync();
+			drain(src, n);
 		} else {
-			this->output.push_back(Traits::to_char_type(c));
-			if (this->output.size() >= max_buffer_size()) {
-				sync();
-			}
+			Traits::copy(BaseT::pptr(), src, room);
+			BaseT::pbump(int(room));
+			sync();
+			Traits::copy(BaseT::pptr(), src + room, n - room);
+			BaseT::pbump(int(n - room));
 		}
 
-		return Traits::not_eof(c);
+		return n;
 	}
 
-	int_type sync() {
-		if (this->output.size() > 0) {
-			if (gzwrite(this->file, &(*(this->output.begin())), this->output.size()) == 0) {
-				throw std::runtime_error("Failed to write buffer to gzip file.");
-			}
-	
-			this->output.clear();
+	int sync() {
+		std::streamsize n = BaseT::pptr() - BaseT::pbase();
+		if (n > 0) {
+			drain(BaseT::pbase(), n);
+			BaseT::setp(begin(), begin() + this->output.size());
 		}
 
 		return 0;
@@ -140,7 +265,12 @@ private:
 template < typename Char = char, typename Traits = std::char_traits<Char> >
 class gzip_ostream : public std::basic_ostream<Char, Traits> {
 public:
-    gzip_ostream(const std::string& fname) : std::basic_ostream<Char, Traits>(&buffer), buffer(fname) {
+    gzip_ostream(const std::string& fname, size_t bufferSize = default_gzip_buffer_size(), const deflate_options& z = deflate_options()) : std::basic_ostream<Char, Traits>(&buffer), buffer(fname, bufferSize, z) {
+    }
+
+    // finish the file (throwing if any of it couldn't be written)
+    void close() {
+		this->buffer.close();
     }
 private:
     typedef gzip_ostream_buffer<Char, Traits> Buffer;
@@ -153,4 +283,4 @@ private:
 
 }
 
-#endif 
+#endif
@@ -0,0 +1,75 @@
+#ifndef IO_PGZIP_STREAM_HPP_INCLUDED
+#define IO_PGZIP_STREAM_HPP_INCLUDED
+
+/*
+ * pgzip_stream : write gz files, compressing blocks of the output in parallel
+ *
+ *   output is cut into fixed-size blocks, each deflated independently (on the
+ *   shared par::pool) but primed with the last 32K of the block before it, and
+ *   the results stitched together into a single ordinary gzip stream
+ */
+#include <io/deflate.hpp>
+#include <iostream>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace io {
+
+class pgzip_ostream_buffer : public std::streambuf {
+public:
+	pgzip_ostream_buffer(const std::string& fname, const deflate_options& z = deflate_options(), size_t blockSize = 128 * 1024);
+	~pgzip_ostream_buffer();
+
+	// compress everything still pending and finish the gzip stream
+	void close();
+
+	struct block {
+		std::vector<char> input;
+		std::vector<char> output;
+		size_t            size;
+		uLong             crc;
+		bool              last;
+	};
+private:
+	typedef std::vector<block> blocks;
+
+	FILE*             file;
+	std::string       fname;
+	deflate_options   z;
+	blocks            pending; // blocks filled (or being filled) since the last compression batch
+	unsigned int      used;    // the number of blocks in 'pending' currently in use
+	std::vector<char> window;  // the tail of the last block written (the dictionary for the next)
+	uLong             crc;
+	uLong             total;
+	bool              closed;
+
+	int_type overflow(int_type c);
+	std::streamsize xsputn(const char* src, std::streamsize n);
+	int sync();
+
+	void nextBlock();
+	void compress(bool finish);
+	void put(const char* data, size_t n);
+
+	pgzip_ostream_buffer();
+	pgzip_ostream_buffer(const pgzip_ostream_buffer&);
+	void operator=(const pgzip_ostream_buffer&);
+};
+
+class pgzip_ostream : public std::ostream {
+public:
+	pgzip_ostream(const std::string& fname, const deflate_options& z = deflate_options(), size_t blockSize = 128 * 1024);
+
+	void close();
+private:
+	pgzip_ostream_buffer buffer;
+
+	pgzip_ostream();
+	pgzip_ostream(const pgzip_ostream&);
+	void operator=(const pgzip_ostream&);
+};
+
+}
+
+#endif
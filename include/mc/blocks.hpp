@@ -0,0 +1,35 @@
+#ifndef MC_BLOCKS_HPP_INCLUDED
+#define MC_BLOCKS_HPP_INCLUDED
+
+/*
+ * blocks : the Minecraft blocks that voxel colors are matched against
+ *
+ *   blocks are numbered densely (#0 is always air), so exporters can keep
+ *   per-block tables and translate them into whichever id scheme they write
+ */
+#include <color/data.hpp>
+
+namespace mc {
+
+typedef unsigned int block;
+
+static const block air = 0;
+
+// the number of distinct blocks that voxels can become
+unsigned int blockCount();
+
+// the block nearest to a color (transparent colors become air)
+block nearestBlock(color::value c);
+
+// a block's legacy (pre-1.13) id and data value
+void blockID(block b, unsigned char& id, unsigned char& data);
+
+// a block's namespaced block state (e.g. "minecraft:red_wool")
+const char* blockState(block b);
+
+// the legacy id and data value nearest to a color
+void toMCVoxel(color::value c, unsigned char& id, unsigned char& data);
+
+}
+
+#endif
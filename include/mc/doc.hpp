@@ -0,0 +1,139 @@
+#ifndef MC_DOC_HPP_INCLUDED
+#define MC_DOC_HPP_INCLUDED
+
+/*
+ * doc : arena-allocated NBT documents
+ *
+ *   an alternative to the 'value' boxes for large trees -- nodes are plain
+ *   tagged variants carved out of one arena, names are interned once per
+ *   document, and the whole document is freed at once
+ */
+#include <mc/value.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace mc {
+
+// a bump allocator, whose memory is only ever released all at once
+class arena {
+public:
+	arena(size_t chunkSize = 64 * 1024);
+	~arena();
+
+	void* alloc(size_t n);
+	void clear();
+
+	size_t size() const; // the number of bytes handed out so far
+private:
+	struct chunk {
+		chunk* prev;
+		size_t size;
+		size_t used;
+	};
+
+	chunk* top;
+	size_t chunkSize;
+	size_t total;
+
+	arena(const arena&);
+	arena& operator=(const arena&);
+};
+
+// a single NBT value
+struct node {
+	tagid       tag;
+	const char* name; // interned in the owning document ("" for list elements)
+	node*       next; // the next value in the enclosing tuple/array
+
+	union {
+		unsigned char b;
+		short         s;
+		int           i;
+		long          l;
+		float         f;
+		double        d;
+
+		// string, bytes, int4s and int8s payloads
+		struct {
+			void*        data;
+			unsigned int size;
+		} arr;
+
+		// tuple and array children
+		struct {
+			node*        first;
+			node*        last;
+			unsigned int size;
+			tagid        etag;
+		} seq;
+	};
+
+	// payload accessors
+	const char*          str()   const;
+	const unsigned char* bytes() const;
+	const int*           ints()  const;
+	const long long*     longs() const;
+	unsigned int         size()  const;
+
+	// find a named child of a tuple (or 0 if there's no such child)
+	node* child(const char* cname) const;
+};
+
+class document {
+public:
+	document();
+
+	node* root() const;
+
+	// build the document -- values are appended to 'parent' (a tuple or array), or become the root if 'parent' is 0
+	node* addTuple(node* parent, const char* name);
+	node* addArray(node* parent, const char* name, tagid etag);
+
+	node* add(node* parent, const char* name, unsigned char x);
+	node* add(node* parent, const char* name, short x);
+	node* add(node* parent, const char* name, int x);
+	node* add(node* parent, const char* name, long x);
+	node* add(node* parent, const char* name, float x);
+	node* add(node* parent, const char* name, double x);
+	node* add(node* parent, const char* name, const std::string& x);
+
+	// array payloads are allocated (uninitialized) in the document, to be filled in by the caller
+	unsigned char* addBytes(node* parent, const char* name, unsigned int n);
+	int*           addInt4s(node* parent, const char* name, unsigned int n);
+	long long*     addInt8s(node* parent, const char* name, unsigned int n);
+
+	// the unique copy of a name in this document
+	const char* intern(const char* name, size_t n);
+	const char* intern(const char* name);
+
+	// read/write/show the Minecraft NBT format
+	void read(std::istream& in);
+	void write(std::ostream& out) const;
+	void show(std::ostream& out) const;
+
+	// drop every node at once
+	void clear();
+
+	size_t memory() const;
+private:
+	typedef std::vector<const char*> names;
+
+	arena        mem;
+	names        table; // an open-addressed hash set of interned names
+	unsigned int nameCount;
+	node*        top;
+
+	node* make(node* parent, tagid tid, const char* name);
+	void  link(node* parent, node* n);
+	void* payload(node* n, size_t count, size_t width);
+
+	node* readValue(std::istream& in, node* parent, tagid tid, const char* name, std::vector<char>& scratch);
+
+	document(const document&);
+	document& operator=(const document&);
+};
+
+}
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef MC_ENDIAN_HPP_INCLUDED
+#define MC_ENDIAN_HPP_INCLUDED
+
+/*
+ * endian : bulk byte-order conversion for NBT arrays
+ *
+ *   NBT is big-endian, so int/long arrays have every element byte-reversed on
+ *   the way in and out -- these do whole arrays at a time with SIMD shuffles
+ *   (src and dst may be the same buffer, but mustn't otherwise overlap)
+ */
+#include <stddef.h>
+
+namespace mc {
+
+void swap32(const void* src, void* dst, size_t n); // n 4-byte elements
+void swap64(const void* src, void* dst, size_t n); // n 8-byte elements
+
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef MC_FUNCTION_HPP_INCLUDED
+#define MC_FUNCTION_HPP_INCLUDED
+
+/*
+ * function: save voxels as datapack function (.mcfunction) files of 'fill' commands
+ *
+ *   runs of the same block are greedily merged into boxes (along x, then z, then y),
+ *   so that a build takes far fewer commands than it has blocks -- boxes stay within
+ *   the game's limit on blocks per 'fill', y slabs of that height are merged
+ *   concurrently, and the commands are split over as many files as it takes to keep
+ *   each under the game's limit on commands per function run
+ *
+ *   blocks are placed relative to where the function is run (the volume's corner goes
+ *   there), and air is left alone
+ */
+#include <geom/voxel.hpp>
+#include <par/progress.hpp>
+#include <string>
+
+namespace mc {
+
+// the default limit on commands per function run (the 'maxCommandChainLength' game rule)
+static const unsigned int maxFunctionCommands = 65536;
+
+// write 'filename' (or, if it takes more than one file, 'name_0.mcfunction', 'name_1.mcfunction', ... for filename 'name.mcfunction')
+void saveFunctions(const geom::volume& v, const std::string& filename, par::progress* prog = 0, unsigned int maxCommands = maxFunctionCommands);
+
+}
+
+#endif
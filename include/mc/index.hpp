@@ -0,0 +1,118 @@
+#ifndef MC_INDEX_HPP_INCLUDED
+#define MC_INDEX_HPP_INCLUDED
+
+/*
+ * index : lazily inspect existing NBT files
+ *
+ *   the file is mapped into memory (or inflated once, if it's gzipped) and
+ *   values are only decoded when asked for -- tuples/arrays find their
+ *   children's offsets the first time they're accessed, and byte/int arrays
+ *   are exposed as views straight into the file data
+ */
+#include <mc/value.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mc {
+
+// the raw bytes of an NBT file
+class blob {
+public:
+	blob(const std::string& filename);
+	~blob();
+
+	const unsigned char* data() const;
+	size_t size() const;
+
+	// true if the file was uncompressed, and is just mapped into memory
+	bool mapped() const;
+private:
+	unsigned char* bytes;
+	size_t         n;
+	bool           isMapped;
+
+	blob();
+	blob(const blob&);
+	blob& operator=(const blob&);
+};
+
+class index;
+
+// a reference to a single (lazily decoded) value in an index
+class entry {
+public:
+	entry();
+
+	bool valid() const;
+	tagid tag() const;
+	std::string name() const;
+
+	// scalar values (the entry must have the matching tag)
+	unsigned char asByte()   const;
+	short         asInt2()   const;
+	int           asInt4()   const;
+	long          asInt8()   const;
+	float         asFloat4() const;
+	double        asFloat8() const;
+	std::string   asString() const;
+
+	// byte/int/long arrays -- 'raw' points into the file (ints are big-endian there)
+	unsigned int         size() const;
+	const unsigned char* raw()  const;
+	int                  int4At(unsigned int i) const;
+	long long            int8At(unsigned int i) const;
+	void                 decode(std::vector<int>& out) const;
+	void                 decode(std::vector<long long>& out) const;
+
+	// tuple and array children
+	unsigned int count() const;
+	entry child(unsigned int i) const;
+	entry child(const std::string& cname) const; // (an invalid entry if there's no such child)
+	tagid elementTag() const;
+private:
+	const index* idx;
+	tagid        tid;
+	size_t       nameAt; // offset of the name's length prefix (or 0 for list elements)
+	size_t       at;     // offset of the payload
+
+	entry(const index* idx, tagid tid, size_t nameAt, size_t at);
+	void expect(tagid t) const;
+	friend class index;
+};
+
+class index {
+public:
+	index(const std::string& filename);
+
+	entry root() const;
+
+	const blob& file() const;
+private:
+	struct child {
+		tagid  tid;
+		size_t nameAt;
+		size_t at;
+	};
+	typedef std::vector<child>              children;
+	typedef std::map<size_t, children>      childIndex;
+	typedef std::map<size_t, size_t>        endIndex;
+
+	blob               bytes;
+	mutable childIndex kids; // the children of each tuple/array that's been looked at
+	mutable endIndex   ends; // where each tuple/array we've walked over ends
+
+	const unsigned char* at(size_t p, size_t n) const;
+	size_t skip(tagid tid, size_t p) const;
+	const children& childrenOf(tagid tid, size_t p) const;
+
+	friend class entry;
+
+	index();
+	index(const index&);
+	index& operator=(const index&);
+};
+
+}
+
+#endif
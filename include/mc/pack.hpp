@@ -0,0 +1,114 @@
+#ifndef MC_PACK_HPP_INCLUDED
+#define MC_PACK_HPP_INCLUDED
+
+/*
+ * pack : big-endian encoding of NBT primitives
+ */
+#include <mc/endian.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace mc {
+
+// br :: Byte<N> -> Byte<N>
+//   byte-reverse
+template <typename T>
+	struct b {
+		static T r(T x) {
+			unsigned char* px = (unsigned char*)&x;
+			static const unsigned int n = sizeof(T) / 2;
+			static const unsigned int e = sizeof(T) - 1;
+	
+			for (unsigned int i = 0; i < n; ++i) {
+				unsigned char b = px[i];
+				px[i]     = px[e - i];
+				px[e - i] = b;
+			}
+			return x;
+		}
+	};
+
+template <typename T>
+	struct b< std::vector<T> > {
+		static std::vector<T> r(const std::vector<T>& xs) {
+			std::vector<T> result(xs.size());
+			for (size_t i = 0; i < xs.size(); ++i) {
+				result[i] = b<T>::r(xs[i]);
+			}
+			return result;
+		}
+	};
+
+// (int and long arrays are reversed in bulk)
+template <>
+	struct b< std::vector<int> > {
+		static std::vector<int> r(const std::vector<int>& xs) {
+			std::vector<int> result(xs.size());
+			if (!xs.empty()) { swap32(&xs[0], &result[0], xs.size()); }
+			return result;
+		}
+	};
+
+template <>
+	struct b< std::vector<long long> > {
+		static std::vector<long long> r(const std::vector<long long>& xs) {
+			std::vector<long long> result(xs.size());
+			if (!xs.empty()) { swap64(&xs[0], &result[0], xs.size()); }
+			return result;
+		}
+	};
+
+template <typename T>
+	T br(const T& x) {
+		return b<T>::r(x);
+	}
+
+// put :: Pack a => Ostream -> a -> ()
+#define DECL_PUT(X) \
+	inline void put(std::ostream& out, X x) { \
+		X nx = br<X>(x); \
+		out.write((const char*)(&nx), sizeof(X)); \
+	}
+
+DECL_PUT(unsigned char);
+DECL_PUT(short);
+DECL_PUT(int);
+DECL_PUT(long);
+DECL_PUT(float);
+DECL_PUT(double);
+
+#undef DECL_PUT
+
+inline void put(std::ostream& out, const char* x, short n) {
+	put(out, n);
+	out.write(x, n);
+}
+
+inline void put(std::ostream& out, const std::string& x) {
+	put(out, x.c_str(), short(x.size()));
+}
+
+// putArray :: Ostream -> [a] -> ()
+//   the elements of an int/long array (without its length), converted a chunk at a time
+template <typename T>
+	inline void putArray(std::ostream& out, const T* xs, size_t n) {
+		static const size_t chunk = 4096 / sizeof(T);
+		T buf[chunk];
+
+		while (n > 0) {
+			size_t k = (n < chunk) ? n : chunk;
+			if (sizeof(T) == 4) {
+				swap32(xs, buf, k);
+			} else {
+				swap64(xs, buf, k);
+			}
+			out.write((const char*)buf, sizeof(T) * k);
+			xs += k;
+			n  -= k;
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef MC_REGION_HPP_INCLUDED
+#define MC_REGION_HPP_INCLUDED
+
+/*
+ * region: save voxels directly into Anvil (.mca) region files
+ *
+ *   the volume is cut into 16x16 chunk columns (of 16x16x16 sections with
+ *   their own bit-packed block palettes), each column is encoded and deflated
+ *   independently on the shared thread pool, and the results are laid out in
+ *   4K sectors of the region files that cover the volume
+ */
+#include <mc/schematic.hpp>
+
+namespace mc {
+
+// write region files (r.<x>.<z>.mca) into 'directory' (created if necessary), with the volume's corner at block (0, 0, 0)
+void saveRegions(const geom::volume& v, const std::string& directory, par::progress* prog = 0, const io::deflate_options& z = io::deflate_options());
+
+}
+
+#endif
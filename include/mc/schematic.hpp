@@ -6,15 +6,15 @@
  */
 #include <color/data.hpp>
 #include <geom/voxel.hpp>
+#include <io/deflate.hpp>
+#include <par/progress.hpp>
 
 #include <iostream>
 #include <string>
 
 namespace mc {
 
-typedef void (*PROGRESSFN)(const std::string&,unsigned int,unsigned int);
-
-void save(const geom::volume& v, const std::string& filename, PROGRESSFN pfn = 0);
+void save(const geom::volume& v, const std::string& filename, par::progress* prog = 0, const io::deflate_options& z = io::deflate_options());
 
 }
 
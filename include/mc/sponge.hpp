@@ -0,0 +1,20 @@
+#ifndef MC_SPONGE_HPP_INCLUDED
+#define MC_SPONGE_HPP_INCLUDED
+
+/*
+ * sponge: save voxels to a Sponge (.schem) schematic file
+ *
+ *   unlike the legacy format, block states are named through a palette built
+ *   for just the blocks that actually occur, and each voxel is stored as a
+ *   varint palette index (so sparse volumes are mostly single bytes of air)
+ */
+#include <mc/schematic.hpp>
+
+namespace mc {
+
+// save in version 2 (WorldEdit 7.0+) or version 3 (WorldEdit 7.3+) of the format
+void saveSponge(const geom::volume& v, const std::string& filename, int version = 2, par::progress* prog = 0, const io::deflate_options& z = io::deflate_options());
+
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MC_SPOOL_HPP_INCLUDED
+#define MC_SPOOL_HPP_INCLUDED
+
+/*
+ * spool : hold back one array of an NBT file while another is written
+ *
+ *   NBT length-prefixes arrays, so data that's produced before (or alongside)
+ *   something that has to be written ahead of it is parked in a temporary file
+ */
+#include <mc/writer.hpp>
+#include <stdio.h>
+#include <vector>
+
+namespace mc {
+
+class spool {
+public:
+	spool();
+	~spool();
+
+	void write(const unsigned char* xs, size_t n);
+	size_t size() const;
+
+	// replay the spooled data into a byte array, in buffer-sized chunks
+	void copyTo(writer& w, std::vector<unsigned char>& buffer);
+private:
+	FILE*  f;
+	size_t n;
+
+	spool(const spool&);
+	spool& operator=(const spool&);
+};
+
+}
+
+#endif
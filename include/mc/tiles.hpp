@@ -0,0 +1,22 @@
+#ifndef MC_TILES_HPP_INCLUDED
+#define MC_TILES_HPP_INCLUDED
+
+/*
+ * tiles: save voxels as a grid of smaller schematics
+ *
+ *   big builds are easier to paste a piece at a time -- the volume is cut into
+ *   tiles of (at most) a fixed size on each axis, tiles are written concurrently,
+ *   tiles that would be entirely air are skipped, and a manifest records where
+ *   each tile file belongs
+ */
+#include <mc/schematic.hpp>
+
+namespace mc {
+
+// write tiles (in 'format': schematic, schem2 or schem3) and a manifest.txt into 'directory' (created if necessary)
+//   if 'changed' is given, only tiles where it has non-empty voxels are written (and the rest are assumed to be there already)
+void saveTiles(const geom::volume& v, const std::string& directory, unsigned int tileSize, const std::string& format = "schematic", par::progress* prog = 0, const io::deflate_options& z = io::deflate_options(), const geom::volume* changed = 0);
+
+}
+
+#endif
@@ -62,6 +62,7 @@ DEF_BOX_CLASS(float4, float);
 DEF_BOX_CLASS(float8, double);
 DEF_BOX_CLASS(bytes,  std::vector<unsigned char>);
 DEF_BOX_CLASS(int4s,  std::vector<int>);
+DEF_BOX_CLASS(int8s,  std::vector<long long>);
 DEF_BOX_CLASS(string, std::string);
 DEF_BOX_CLASS(array,  hvalues);
 DEF_BOX_CLASS(tuple,  values);
@@ -0,0 +1,81 @@
+#ifndef MC_WRITER_HPP_INCLUDED
+#define MC_WRITER_HPP_INCLUDED
+
+/*
+ * writer : emit the Minecraft NBT format incrementally
+ *
+ *   rather than building a tree of values and then writing it out, tags are
+ *   written as they're declared, and byte/int/long arrays may be written in chunks
+ *   (their lengths have to be known up front, since NBT length-prefixes them)
+ */
+#include <mc/value.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace mc {
+
+class writer {
+public:
+	writer(std::ostream& out);
+
+	// compound values (a sequence of named values of any type)
+	void beginTuple(const char* name);
+	void endTuple();
+
+	// list values (a sequence of 'count' unnamed values of type 'etag')
+	void beginArray(const char* name, tagid etag, int count);
+	void endArray();
+
+	// scalar values
+	void put(const char* name, unsigned char x);
+	void put(const char* name, short x);
+	void put(const char* name, int x);
+	void put(const char* name, long x);
+	void put(const char* name, float x);
+	void put(const char* name, double x);
+	void put(const char* name, const std::string& x);
+
+	// byte arrays, written in as many chunks as necessary
+	void beginBytes(const char* name, int count);
+	void putBytes(const unsigned char* xs, unsigned int n);
+	void endBytes();
+
+	// int arrays, written in as many chunks as necessary
+	void beginInt4s(const char* name, int count);
+	void putInt4s(const int* xs, unsigned int n);
+	void endInt4s();
+
+	// long arrays, likewise
+	void beginInt8s(const char* name, int count);
+	void putInt8s(const long long* xs, unsigned int n);
+	void endInt8s();
+
+	// true when every value begun has also been ended
+	bool done() const;
+private:
+	struct frame {
+		tagid tag;
+		tagid etag;
+		int   remaining;
+
+		frame(tagid tag, tagid etag, int remaining);
+	};
+	typedef std::vector<frame> frames;
+
+	std::ostream& out;
+	frames        stack;
+
+	void header(tagid tid, const char* name);
+	void chunk(tagid tid, unsigned int n);
+	void end(tagid tid);
+
+	writer();
+	writer(const writer&);
+	writer& operator=(const writer&);
+};
+
+}
+
+#endif
+
@@ -3,23 +3,48 @@
 
 #include <geom/triset.hpp>
 #include <color/texture.hpp>
+#include <par/progress.hpp>
 #include <string>
 #include <map>
 #include <vector>
 
 namespace obj {
 
-typedef void (*PROGRESSFN)(const std::string&,unsigned int,unsigned int);
+// where a reader can send faces as it reads them, a batch at a time (rather than keeping them all)
+struct faceSink {
+	virtual ~faceSink();
+
+	// (the sink may take the batch's contents, e.g. by swapping them out)
+	virtual void faces(std::vector<geom::triangle>& batch) = 0;
+
+	// the last batch has been sent (or reading failed) -- faces refer to the reader's textures, so
+	// are only valid until this returns
+	virtual void finished() = 0;
+};
+
+// the bounds of every vertex in an OBJ file, from a quick pass over just its vertices
+// (so that faces can be placed in a grid as they're read)
+void vertexBounds(const std::string& filename, geom::point& lo, geom::point& hi);
 
 class reader {
 public:
-	reader(const std::string& filename, PROGRESSFN pfn = 0);
+	reader(const std::string& filename, par::progress* prog = 0);
+
+	// stream faces to 'out' instead of keeping them (the reader still owns their textures)
+	reader(const std::string& filename, faceSink& out, par::progress* prog = 0);
 
 	const geom::triset& faces() const;
 private:
 	// our final face-set, suitable for rendering
 	geom::triset data;
 
+	// or where faces are streamed to, and the batch being filled for it
+	faceSink*                   sink;
+	std::vector<geom::triangle> batch;
+
+	void read(const std::string& filename, par::progress* prog);
+	void addFace(const geom::triangle& tri);
+
 	typedef std::map<std::string, color::texture> Textures;
 	Textures textures;
 	void readTextures(const std::string& texfile);
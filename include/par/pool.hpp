@@ -0,0 +1,135 @@
+#ifndef PAR_POOL_HPP_INCLUDED
+#define PAR_POOL_HPP_INCLUDED
+
+/*
+ * pool : a fixed set of worker threads to run tasks on
+ */
+#include <pthread.h>
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace par {
+
+// the number of processors available to us
+unsigned int cores();
+
+// a unit of work for a pool
+struct task {
+	virtual ~task();
+	virtual void run() = 0;
+};
+
+// a set of tasks that can be waited on together
+class group {
+public:
+	group();
+private:
+	unsigned int pending;
+	bool         failed;
+	std::string  error;
+
+	friend class pool;
+};
+
+class pool {
+public:
+	pool(unsigned int threads);
+	~pool();
+
+	// the number of worker threads
+	unsigned int size() const;
+
+	// queue a task (not owned by the pool) to run on some worker thread
+	void push(task* t, group& g);
+
+	// block until every task in a group has finished, running queued tasks in the meantime
+	// (so that tasks can safely wait on tasks of their own) -- rethrows the first failure in the group
+	void wait(group& g);
+private:
+	struct item {
+		task*  t;
+		group* g;
+	};
+	typedef std::deque<item>       items;
+	typedef std::vector<pthread_t> threads;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t  ready;
+	pthread_cond_t  finished;
+	items           queue;
+	threads         workers;
+	bool            stopping;
+
+	static void* work(void* p);
+	void exec(const item& i);
+
+	pool(const pool&);
+	pool& operator=(const pool&);
+};
+
+// the process-wide pool (sized to the machine unless told otherwise before first use)
+void setThreads(unsigned int n);
+unsigned int threads();
+pool& shared();
+
+// each :: (Int -> ()) -> [0,n) -> ()
+//   run f(i) for each i in [0,n), spread over the shared pool (f must be safe to call concurrently)
+template <typename F>
+	struct eachTask : public task {
+		F*                     f;
+		unsigned int           n;
+		volatile unsigned int* next;
+
+		void run() {
+			unsigned int i = 0;
+			while ((i = __sync_fetch_and_add(next, 1)) < n) {
+				(*f)(i);
+			}
+		}
+	};
+
+template <typename F>
+	void each(unsigned int n, F& f) {
+		if (n == 0) {
+			return;
+		}
+
+		pool&                      p    = shared();
+		unsigned int               k    = std::min<unsigned int>(p.size(), n - 1);
+		volatile unsigned int      next = 0;
+		std::vector< eachTask<F> > ts(k + 1);
+		group                      g;
+
+		for (unsigned int i = 0; i <= k; ++i) {
+			ts[i].f    = &f;
+			ts[i].n    = n;
+			ts[i].next = &next;
+		}
+
+		for (unsigned int i = 0; i < k; ++i) {
+			p.push(&ts[i], g);
+		}
+
+		// the calling thread takes a share of the work too
+		std::string err;
+		bool        failed = false;
+		try {
+			ts[k].run();
+		} catch (std::exception& ex) {
+			err    = ex.what();
+			failed = true;
+			next   = n;
+		}
+
+		p.wait(g);
+		if (failed) {
+			throw std::runtime_error(err);
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef PAR_PROGRESS_HPP_INCLUDED
+#define PAR_PROGRESS_HPP_INCLUDED
+
+/*
+ * progress : count work done without slowing it down
+ *
+ *   a long job is a series of steps, each with some number of units of work --
+ *   loops only bump the count (a relaxed atomic add, with no locks, clock reads or
+ *   output), and a reporter thread draws it at a fixed rate
+ */
+#include <pthread.h>
+#include <iostream>
+#include <string>
+
+namespace par {
+
+class progress {
+public:
+	progress();
+	~progress();
+
+	// start the next step, of 'total' units (or 0 if the size isn't known)
+	void begin(const std::string& step, unsigned long total = 0);
+
+	// count units done on the current step (from any thread)
+	void add(unsigned long n = 1) {
+		__atomic_fetch_add(&this->done, n, __ATOMIC_RELAXED);
+	}
+
+	// where a step stands (steps are numbered from 1, and started at a time in milliseconds)
+	struct status {
+		unsigned int  id;
+		std::string   step;
+		unsigned long done;
+		unsigned long total;
+		double        started;
+	};
+
+	// the current step, and the (final) status of the step before it
+	void read(status& current, status& previous) const;
+private:
+	mutable pthread_mutex_t mutex;
+	status                  last;
+	unsigned int            id;
+	std::string             step;
+	unsigned long           total;
+	double                  started;
+	unsigned long           done;
+
+	progress(const progress&);
+	progress& operator=(const progress&);
+};
+
+// draw a job's progress every 'intervalMS' on a thread of its own, until the reporter is destroyed
+// (nothing is drawn, and there's no thread, if 'out' isn't going to a terminal)
+class reporter {
+public:
+	reporter(const progress& p, int fd = 1, std::ostream& out = std::cout, unsigned int intervalMS = 100);
+	~reporter();
+private:
+	const progress& p;
+	std::ostream&   out;
+	unsigned int    intervalMS;
+	bool            running;
+	bool            stopping;
+	pthread_t       thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t  wake;
+	unsigned int    shown; // the last step drawn
+
+	static void* run(void* self);
+	void draw();
+
+	reporter(const reporter&);
+	reporter& operator=(const reporter&);
+};
+
+// the time, in milliseconds
+double now();
+
+}
+
+#endif
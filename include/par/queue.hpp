@@ -0,0 +1,95 @@
+#ifndef PAR_QUEUE_HPP_INCLUDED
+#define PAR_QUEUE_HPP_INCLUDED
+
+/*
+ * queue : a bounded, lock-free queue from one producer thread to one consumer thread
+ *
+ *   items live in a fixed ring of slots, and move in and out by swapping (so a slot's
+ *   storage is reused, and passing a batch along never copies it) -- the two ends only
+ *   share a head and tail index, published with release/acquire atomics, and an end
+ *   that has to wait (for room, or for an item) yields its processor until it can go on
+ *
+ *   either end can close the queue: the producer when it has nothing more (the consumer
+ *   drains what's left), or the consumer when it gives up (so the producer stops too)
+ */
+#include <algorithm>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+
+namespace par {
+
+// wait a little longer each time an end of a queue finds it can't go on yet
+inline void backoff(unsigned int& tries) {
+	if (++tries < 64) {
+		sched_yield();
+	} else {
+		usleep(100);
+	}
+}
+
+template <typename T>
+	class queue {
+	public:
+		queue(unsigned int capacity) : slots(std::max(1u, capacity) + 1), head(0), tail(0), closed(false) {
+		}
+
+		// move an item in (waiting while the queue is full) -- false if the consumer closed the queue
+		bool push(T& x) {
+			unsigned int t     = __atomic_load_n(&this->tail, __ATOMIC_RELAXED);
+			unsigned int next  = (t + 1) % this->slots.size();
+			unsigned int tries = 0;
+
+			while (next == __atomic_load_n(&this->head, __ATOMIC_ACQUIRE)) {
+				if (isClosed()) {
+					return false;
+				}
+				backoff(tries);
+			}
+			if (isClosed()) {
+				return false;
+			}
+
+			std::swap(this->slots[t], x);
+			__atomic_store_n(&this->tail, next, __ATOMIC_RELEASE);
+			return true;
+		}
+
+		// move the next item out (waiting while the queue is empty) -- false once it's closed and drained
+		bool pop(T& x) {
+			unsigned int h     = __atomic_load_n(&this->head, __ATOMIC_RELAXED);
+			unsigned int tries = 0;
+
+			while (h == __atomic_load_n(&this->tail, __ATOMIC_ACQUIRE)) {
+				// (the tail is checked again after seeing the queue closed, so nothing pushed before then is missed)
+				if (isClosed() && h == __atomic_load_n(&this->tail, __ATOMIC_ACQUIRE)) {
+					return false;
+				}
+				backoff(tries);
+			}
+
+			std::swap(this->slots[h], x);
+			__atomic_store_n(&this->head, (h + 1) % this->slots.size(), __ATOMIC_RELEASE);
+			return true;
+		}
+
+		void close() {
+			__atomic_store_n(&this->closed, true, __ATOMIC_RELEASE);
+		}
+
+		bool isClosed() const {
+			return __atomic_load_n(&this->closed, __ATOMIC_ACQUIRE);
+		}
+	private:
+		std::vector<T> slots; // (one more than the capacity, so that a full queue isn't mistaken for an empty one)
+		unsigned int   head;  // the next slot to pop (only moved by the consumer)
+		unsigned int   tail;  // the next slot to push (only moved by the producer)
+		bool           closed;
+
+		queue(const queue&);
+		queue& operator=(const queue&);
+	};
+
+}
+
+#endif
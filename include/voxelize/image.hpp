@@ -1,11 +1,12 @@
 #ifndef VOXELIZE_IMAGE_HPP_INCLUDED
 #define VOXELIZE_IMAGE_HPP_INCLUDED
 
-#include <Magick++.h>
+#include <color/decode.hpp>
 #include <geom/voxel.hpp>
 
 namespace voxelize {
 
+// a flat (one voxel deep) volume from an image, box-filtered down to the maximum extent
 class image : public geom::volume {
 public:
 	image(unsigned int maxVoxExt, const std::string& file);
@@ -15,8 +16,13 @@ public:
 	unsigned int depth()  const;
 
 	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
 private:
-	Magick::Image img;
+	// voxels are stored bottom row first (so rows line up with y)
+	unsigned int  w;
+	unsigned int  h;
+	color::pixels data;
 };
 
 }
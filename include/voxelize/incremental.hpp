@@ -0,0 +1,121 @@
+#ifndef VOXELIZE_INCREMENTAL_HPP_INCLUDED
+#define VOXELIZE_INCREMENTAL_HPP_INCLUDED
+
+/*
+ * incremental : re-voxelize a mesh as it's edited
+ *
+ *   voxels keep color sums (rather than lists of colors) so that triangles can be
+ *   taken back out of them as well as put in, and those sums are saved along with
+ *   a hash of every triangle -- the next run against the same state only rasterizes
+ *   the triangles that were added or removed since, and notes which voxels that touched
+ *
+ *   the state is only reused while the mesh's bounds and the max extent stay the same
+ *   (otherwise every voxel would move), and it's saved in native byte order
+ */
+#include <voxelize/triset.hpp>
+#include <geom/voxel.hpp>
+#include <string>
+#include <vector>
+
+namespace voxelize {
+
+// the color samples that have landed in one voxel
+struct colorSum {
+	unsigned int r, g, b, a;
+	unsigned int n;
+
+	colorSum();
+};
+
+class incremental;
+
+// the voxels that an update touched (as opaque voxels, with the rest empty)
+class changeMask : public geom::volume {
+public:
+	changeMask(const incremental& v);
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+private:
+	const incremental& v;
+};
+
+class incremental : public geom::volume {
+public:
+	// 'key' is anything else the saved state has to agree with for its output to be reused (e.g. how voxels are exported)
+	incremental(unsigned int maxVoxExt, const geom::triset& tris, const std::string& stateFile, const std::string& key = "", par::progress* prog = 0);
+	~incremental();
+
+	// record the state for the next run
+	void save(const std::string& stateFile) const;
+
+	// what the update did (if nothing could be reused, every triangle was added and every voxel changed)
+	bool   reused()  const;
+	size_t added()   const;
+	size_t removed() const;
+	const geom::volume& changes() const;
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+	void rowSpans(unsigned int y, unsigned int z, geom::spans& out) const;
+private:
+	// a texture, identified by a hash of its contents (only flat colors can be rebuilt from this alone)
+	struct textureRecord {
+		unsigned long long hash;
+		unsigned char      flat;
+		color::value       kd;
+	};
+	typedef std::vector<textureRecord> textureRecords;
+
+	// a triangle (in mesh coordinates), identified by a hash of its points and texture
+	struct triangleRecord {
+		unsigned long long hash;
+		unsigned int       texture; // an index into the texture records (or 'noTexture')
+		double             ps[15];  // x, y, z, u, v for each point
+	};
+	typedef std::vector<triangleRecord> triangleRecords;
+	static const unsigned int noTexture = ~0u;
+
+	unsigned int    maxVoxExt;
+	double          bounds[6];
+	std::string     key;
+	unsigned int    w;
+	unsigned int    h;
+	unsigned int    d;
+	colorSum**      data;
+	textureRecords  textures;
+	triangleRecords tris;
+
+	bool              isReused;
+	bool              allChanged;
+	size_t            nAdded;
+	size_t            nRemoved;
+	std::vector<bool> changed;
+	changeMask        mask;
+	friend class changeMask;
+	friend struct addSamples;
+	friend struct removeSamples;
+
+	bool load(const std::string& stateFile);
+	void reset();
+	void alloc();
+	void free();
+	colorSum* cell(unsigned int x, unsigned int y, unsigned int z);
+	unsigned int index(unsigned int x, unsigned int y, unsigned int z) const;
+
+	incremental();
+	incremental(const incremental&);
+	incremental& operator=(const incremental&);
+};
+
+}
+
+#endif
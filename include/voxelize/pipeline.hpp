@@ -0,0 +1,44 @@
+#ifndef VOXELIZE_PIPELINE_HPP_INCLUDED
+#define VOXELIZE_PIPELINE_HPP_INCLUDED
+
+/*
+ * pipeline : voxelize an OBJ mesh while it's still being read
+ *
+ *   the mesh is parsed on a thread of its own, which sends batches of faces down a
+ *   bounded queue to be placed and rasterized as they arrive -- so reading and
+ *   rasterizing overlap, and only a few batches of faces are held at once (rather
+ *   than the whole mesh, unless it's filled and needs them all again for that)
+ *
+ *   faces are placed before the whole mesh has been read, so the grid spans every
+ *   vertex in the file (found by a quick pass over just the vertices, first) -- this
+ *   only differs from the grid over the faces if some vertices aren't in any face
+ */
+#include <voxelize/triset.hpp>
+#include <string>
+
+namespace voxelize {
+
+class pipeline : public geom::volume {
+public:
+	pipeline(unsigned int maxVoxExt, const std::string& objFile, par::progress* prog = 0, const interiorFill& fill = interiorFill(), colorResolution resolve = averageColors);
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+	void rowSpans(unsigned int y, unsigned int z, geom::spans& out) const;
+private:
+	grid   g;
+	triset voxels;
+
+	pipeline();
+	pipeline(const pipeline&);
+	pipeline& operator=(const pipeline&);
+};
+
+}
+
+#endif
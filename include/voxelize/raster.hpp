@@ -0,0 +1,69 @@
+#ifndef VOXELIZE_RASTER_HPP_INCLUDED
+#define VOXELIZE_RASTER_HPP_INCLUDED
+
+#include <geom/triset.hpp>
+#include <geom/line.hpp>
+#include <algorithm>
+#include <math.h>
+
+namespace voxelize {
+
+// rasterize a 3D triangle (in voxel space) to a w x h x d grid, with 'out.put(x, y, z, c)' for each sample
+template <typename Sink>
+	void rasterize(const geom::triangle& tri, unsigned int w, unsigned int h, unsigned int d, Sink& out) {
+		double ls0[] = { tri.p0.x, tri.p0.y, tri.p0.z, tri.p0.u, tri.p0.v, /**/ tri.p1.x, tri.p1.y, tri.p1.z, tri.p1.u, tri.p1.v };
+		double ls1[] = { tri.p2.x, tri.p2.y, tri.p2.z, tri.p2.u, tri.p2.v, /**/ tri.p2.x, tri.p2.y, tri.p2.z, tri.p2.u, tri.p2.v };
+
+		// flat-colored triangles don't need to sample their texture at each point
+		bool         flat = tri.flat();
+		color::value fc   = tri.flatColor();
+
+		// now triangulate
+		geom::line<10> area(ls0, ls1);
+		while (!area.done()) {
+			const double* ln = area.point();
+
+			double p0[] = { ln[0], ln[1], ln[2], ln[3], ln[4] };
+			double p1[] = { ln[5], ln[6], ln[7], ln[8], ln[9] };
+
+			geom::line<5> line(p0, p1);
+			while (!line.done()) {
+				const double* pt = line.point();
+
+				double x = pt[0];
+				double y = pt[1];
+				double z = pt[2];
+				double u = pt[3];
+				double v = pt[4];
+
+				if (isnan(x)) { x = 0; }
+				if (isnan(y)) { y = 0; }
+				if (isnan(z)) { z = 0; }
+
+				int pxs[] = { int(floor(x)), int(ceil(x)) };
+				int pys[] = { int(floor(y)), int(ceil(y)) };
+				int pzs[] = { int(floor(z)), int(ceil(z)) };
+				color::value c = flat ? fc : tri.color(u, v);
+
+				for (int xi = 0; xi < 2; ++xi) {
+					for (int yi = 0; yi < 2; ++yi) {
+						for (int zi = 0; zi < 2; ++zi) {
+							int vx = std::min<int>(pxs[xi], w - 1);
+							int vy = std::min<int>(pys[yi], h - 1);
+							int vz = std::min<int>(pzs[zi], d - 1);
+
+							out.put(vx, vy, vz, c);
+						}
+					}
+				}
+
+				++line;
+			}
+
+			++area;
+		}
+	}
+
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef VOXELIZE_SKETCH_HPP_INCLUDED
+#define VOXELIZE_SKETCH_HPP_INCLUDED
+
+/*
+ * sketch : the most common colors among a voxel's samples, in constant space
+ *
+ *   each of a few slots counts the samples of one color (samples close enough to a
+ *   slot's mean count as the same color), and a sample that fits no slot takes over
+ *   the least counted one, inheriting its count ("space saving") -- so any color with
+ *   more than 1/k of the samples is sure to hold a slot, however many samples land here
+ */
+#include <color/data.hpp>
+
+namespace voxelize {
+
+class sketch {
+public:
+	static const unsigned int k = 4;
+
+	sketch();
+
+	void add(color::value c);
+
+	// the mean of the most counted color (the material that most of the voxel is made of)
+	color::value dominant() const;
+private:
+	color::value means[k];
+	unsigned int counts[k]; // (0 for unused slots)
+};
+
+}
+
+#endif
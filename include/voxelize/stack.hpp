@@ -0,0 +1,42 @@
+#ifndef VOXELIZE_STACK_HPP_INCLUDED
+#define VOXELIZE_STACK_HPP_INCLUDED
+
+#include <color/decode.hpp>
+#include <geom/voxel.hpp>
+#include <par/progress.hpp>
+#include <string>
+#include <vector>
+
+namespace voxelize {
+
+// a volume from a directory of slice images (as from a CT scan or a layered render)
+//
+//   slices are taken in file name order, from the bottom of the volume up, and
+//   each one is a horizontal (x, z) cross-section -- slices are decoded and
+//   box-filtered a batch at a time on the shared pool, so only a few are ever
+//   held at full size
+class stack : public geom::volume {
+public:
+	// each y layer of the volume averages 'sliceStep' slices (or more, if that's needed to stay within maxVoxExt)
+	stack(unsigned int maxVoxExt, const std::string& directory, unsigned int sliceStep = 1, par::progress* prog = 0);
+
+	unsigned int width()  const;
+	unsigned int height() const;
+	unsigned int depth()  const;
+
+	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+
+	// the image files in a directory, in name order
+	static std::vector<std::string> slices(const std::string& directory);
+private:
+	unsigned int  w;
+	unsigned int  h;
+	unsigned int  d;
+	color::pixels data; // y layers, each a series of z rows
+};
+
+}
+
+#endif
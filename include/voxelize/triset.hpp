@@ -4,13 +4,14 @@
 #include <geom/triset.hpp>
 #include <geom/voxel.hpp>
 #include <color/data.hpp>
+#include <par/progress.hpp>
+#include <voxelize/sketch.hpp>
 #include <list>
 #include <string>
+#include <vector>
 
 namespace voxelize {
 
-typedef void (*PROGRESSFN)(const std::string&,unsigned int,unsigned int);
-
 struct aabb {
 	double x0, x1;
 	double y0, y1;
@@ -23,33 +24,94 @@ struct aabb {
 	double depth() const;
 };
 
+// the voxel grid for a mesh's bounds, and the transform of its triangles into it
+struct grid {
+	unsigned int w, h, d;
+	geom::point  to;
+	double       sx, sy, sz;
+
+	grid(unsigned int maxVoxExt, const aabb& bounds);
+
+	geom::triangle place(const geom::triangle& t) const;
+};
+
 typedef std::list<color::value> colors;
 
+// how the color samples in each voxel are made into one color
+enum colorResolution {
+	averageColors,  // the average of every sample
+	dominantColors  // the most common color among the samples (kept in a constant-size sketch, so materials don't blur together)
+};
+
+// how to fill the inside of a closed mesh
+struct interiorFill {
+	bool         solid;    // fill at all? (otherwise only surfaces are voxelized)
+	bool         winding;  // decide what's inside by winding number (for meshes with holes), rather than by crossing parity
+	bool         useColor; // fill with 'color', rather than the colors of the nearest surfaces
+	color::value color;
+
+	interiorFill();
+};
+
+// a run [y0, y1) of interior voxels in one column
+struct fillRun {
+	unsigned int y0;
+	unsigned int y1;
+	color::value c;
+
+	fillRun(unsigned int y0, unsigned int y1, color::value c);
+};
+typedef std::vector<fillRun> fillRuns;
+
 class triset : public geom::volume {
 public:
-	triset(unsigned int maxVoxExt, const geom::triset& tris, PROGRESSFN pfn = 0);
+	triset(unsigned int maxVoxExt, const geom::triset& tris, par::progress* prog = 0, const interiorFill& fill = interiorFill(), colorResolution resolve = averageColors);
+
+	// an empty volume, for triangles to be added to as they come (e.g. while a mesh is still being read)
+	triset(const grid& g, colorResolution resolve = averageColors);
 	~triset();
 
+	// rasterize a triangle already placed in the grid
+	void rasterize(const geom::triangle& tri);
+
+	// fill between the surfaces crossed by each (x, z) column, or wherever the mesh winds around voxels
+	// (given every triangle placed in the grid, after they've all been rasterized)
+	void fillInterior(const std::vector<geom::triangle>& tris, const interiorFill& fill, par::progress* prog);
+
 	unsigned int width()  const;
 	unsigned int height() const;
 	unsigned int depth()  const;
 
 	color::value voxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+	void readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const;
+	void rowSpans(unsigned int y, unsigned int z, geom::spans& out) const;
 private:
-	// the main mesh -> voxel rasterization process
-	void rasterize(const geom::triangle& tri);
+	void addInteriorRun(unsigned int x, unsigned int z, int y0, int y1, const interiorFill& fill);
+	friend struct putVoxels;
+	friend struct fillRows;
+	friend struct windColumns;
 private:
 	unsigned int w;
 	unsigned int h;
 	unsigned int d;
-	void initVolume(unsigned int maxVoxExt, double cx, double cy, double cz);
 
-	const colors* lookup(unsigned int x, unsigned int y, unsigned int z) const;
-	colors* cell(unsigned int x, unsigned int y, unsigned int z);
+	// (only one of these is kept, depending on how colors are resolved -- sketches are
+	// pooled, and each voxel keeps 1 + its sketch's place in the pool, or 0 if it wasn't hit)
+	colors**                  data;
+	std::vector<sketch>       sketches;
+	std::vector<unsigned int> sketched;
+
+	bool hit(unsigned int i) const;
+	color::value resolved(unsigned int i) const;
+	void add(unsigned int x, unsigned int y, unsigned int z, color::value c);
 	unsigned int index(unsigned int x, unsigned int y, unsigned int z) const;
-	void alloc();
+	void alloc(colorResolution resolve);
 	void free();
-	colors** data;
+
+	// interior runs, for each (x, z) column (empty unless the volume is solid)
+	std::vector<fillRuns> interior;
+	const fillRun* interiorAt(unsigned int x, unsigned int y, unsigned int z) const;
 };
 
 }
@@ -0,0 +1,136 @@
+
+#include <color/cache.hpp>
+#include <map>
+#include <pthread.h>
+#include <stdlib.h>
+
+namespace color {
+
+struct cachedImage {
+	image              img;
+	bool               ready;    // (false while the first reader is still decoding it)
+	unsigned long long lastUse;
+};
+typedef std::map<std::string, cachedImage*> cachedImages;
+
+static pthread_mutex_t    cacheMutex   = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     cacheDecoded = PTHREAD_COND_INITIALIZER;
+static cachedImages       cache;
+static size_t             cacheBudget  = 0;
+static size_t             cacheBytes   = 0;
+static size_t             cacheHits    = 0;
+static size_t             cacheMisses  = 0;
+static unsigned long long useClock     = 0;
+
+inline size_t bytesOf(const image& img) {
+	return img.data.size() * sizeof(value);
+}
+
+// drop the least recently used images until everything fits (must hold the lock)
+void evict() {
+	while (cacheBytes > cacheBudget) {
+		cachedImages::iterator lru = cache.end();
+		for (cachedImages::iterator i = cache.begin(); i != cache.end(); ++i) {
+			if (i->second->ready && (lru == cache.end() || i->second->lastUse < lru->second->lastUse)) {
+				lru = i;
+			}
+		}
+		if (lru == cache.end()) {
+			break;
+		}
+
+		cacheBytes -= bytesOf(lru->second->img);
+		delete lru->second;
+		cache.erase(lru);
+	}
+}
+
+void setImageCache(size_t bytes) {
+	pthread_mutex_lock(&cacheMutex);
+	cacheBudget = bytes;
+	evict();
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+// the same file can be reached by different relative paths
+std::string canonicalPath(const std::string& filename) {
+	char* p = realpath(filename.c_str(), 0);
+	if (p == 0) {
+		return filename;
+	}
+	std::string r(p);
+	::free(p);
+	return r;
+}
+
+void readCached(const std::string& filename, image& out) {
+	pthread_mutex_lock(&cacheMutex);
+	if (cacheBudget == 0) {
+		pthread_mutex_unlock(&cacheMutex);
+		read(filename, out);
+		return;
+	}
+	pthread_mutex_unlock(&cacheMutex);
+
+	std::string key = canonicalPath(filename);
+
+	pthread_mutex_lock(&cacheMutex);
+	while (true) {
+		cachedImages::iterator i = cache.find(key);
+		if (i == cache.end()) {
+			break;
+		} else if (i->second->ready) {
+			++cacheHits;
+			i->second->lastUse = ++useClock;
+			out = i->second->img;
+			pthread_mutex_unlock(&cacheMutex);
+			return;
+		}
+
+		// someone else is decoding it (and if they fail, it's gone when we wake up)
+		pthread_cond_wait(&cacheDecoded, &cacheMutex);
+	}
+
+	++cacheMisses;
+	cachedImage* c = new cachedImage();
+	c->ready   = false;
+	c->lastUse = ++useClock;
+	cache[key] = c;
+	pthread_mutex_unlock(&cacheMutex);
+
+	try {
+		read(filename, c->img);
+	} catch (...) {
+		pthread_mutex_lock(&cacheMutex);
+		cache.erase(key);
+		delete c;
+		pthread_cond_broadcast(&cacheDecoded);
+		pthread_mutex_unlock(&cacheMutex);
+		throw;
+	}
+
+	pthread_mutex_lock(&cacheMutex);
+	out        = c->img;
+	c->ready   = true;
+	cacheBytes += bytesOf(c->img);
+	evict();
+	pthread_cond_broadcast(&cacheDecoded);
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+size_t imageCacheHits() {
+	pthread_mutex_lock(&cacheMutex);
+	size_t n = cacheHits;
+	pthread_mutex_unlock(&cacheMutex);
+	return n;
+}
+
+size_t imageCacheMisses() {
+	pthread_mutex_lock(&cacheMutex);
+	size_t n = cacheMisses;
+	pthread_mutex_unlock(&cacheMutex);
+	return n;
+}
+
+}
+
@@ -0,0 +1,487 @@
+
+#include <color/decode.hpp>
+#include <str/Util.hpp>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+namespace color {
+
+image::image() : width(0), height(0) {
+}
+
+typedef std::vector<unsigned char> bytes;
+
+bytes readFile(const std::string& filename) {
+	std::ifstream f(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!f.is_open()) {
+		throw std::runtime_error("Unable to open the image file '" + filename + "' for reading.");
+	}
+
+	f.seekg(0, std::ios::end);
+	std::streamoff n = f.tellg();
+	f.seekg(0, std::ios::beg);
+
+	bytes result(size_t(n > 0 ? n : 0));
+	if (result.size() > 0) {
+		f.read((char*)&(*(result.begin())), result.size());
+	}
+	return result;
+}
+
+void read(const std::string& filename, image& out) {
+	if (!decode(filename, out)) {
+		readMagick(filename, out);
+	}
+}
+
+bool decode(const std::string& filename, image& out) {
+	std::string ext = str::lcase(str::rsplit<char>(filename, ".").second);
+	if (ext != "png" && ext != "tga" && ext != "ppm" && ext != "pgm" && ext != "pnm") {
+		return false;
+	}
+
+	bytes data = readFile(filename);
+	if (decodePNG(data, out) || decodePNM(data, out) || (ext == "tga" && decodeTGA(data, out))) {
+		return true;
+	} else {
+		return false;
+	}
+}
+
+void allocImage(unsigned int w, unsigned int h, image& out) {
+	if (w == 0 || h == 0 || w > 0x8000 || h > 0x8000) {
+		throw std::runtime_error("Invalid image dimensions: " + str::to_string(w) + "x" + str::to_string(h));
+	}
+
+	out.width  = w;
+	out.height = h;
+	out.data.resize(size_t(w) * size_t(h));
+}
+
+/*
+ * PNG
+ */
+inline unsigned int be32(const unsigned char* p) {
+	return (unsigned int)(p[0] << 24) | (unsigned int)(p[1] << 16) | (unsigned int)(p[2] << 8) | (unsigned int)(p[3]);
+}
+
+inline unsigned char paeth(int a, int b, int c) {
+	int p  = a + b - c;
+	int pa = ::abs(p - a);
+	int pb = ::abs(p - b);
+	int pc = ::abs(p - c);
+
+	if (pa <= pb && pa <= pc) {
+		return a;
+	} else if (pb <= pc) {
+		return b;
+	} else {
+		return c;
+	}
+}
+
+// reverse the per-scanline filters in place (scanlines are prefixed by their filter type)
+void unfilterPNG(unsigned char* data, unsigned int h, size_t stride, unsigned int bpp) {
+	unsigned char* prev = 0;
+
+	for (unsigned int y = 0; y < h; ++y) {
+		unsigned char  ft  = data[y * (stride + 1)];
+		unsigned char* row = data + y * (stride + 1) + 1;
+
+		switch (ft) {
+		case 0:
+			break;
+		case 1:
+			for (size_t i = bpp; i < stride; ++i) {
+				row[i] += row[i - bpp];
+			}
+			break;
+		case 2:
+			if (prev) {
+				for (size_t i = 0; i < stride; ++i) {
+					row[i] += prev[i];
+				}
+			}
+			break;
+		case 3:
+			for (size_t i = 0; i < stride; ++i) {
+				int a = (i >= bpp) ? row[i - bpp] : 0;
+				int b = prev ? prev[i] : 0;
+				row[i] += (unsigned char)((a + b) >> 1);
+			}
+			break;
+		case 4:
+			for (size_t i = 0; i < stride; ++i) {
+				int a = (i >= bpp) ? row[i - bpp] : 0;
+				int b = prev ? prev[i] : 0;
+				int c = (i >= bpp && prev) ? prev[i - bpp] : 0;
+				row[i] += paeth(a, b, c);
+			}
+			break;
+		default:
+			throw std::runtime_error("Invalid PNG scanline filter #" + str::to_string(int(ft)));
+		}
+
+		prev = row;
+	}
+}
+
+// read the i-th sample of a scanline with the given bit depth (scaled to 8 bits)
+inline unsigned char sampleAt(const unsigned char* row, unsigned int i, unsigned int depth) {
+	switch (depth) {
+	case 1:  return ((row[i >> 3] >> (7 - (i & 7))) & 0x01) * 0xff;
+	case 2:  return ((row[i >> 2] >> (6 - 2 * (i & 3))) & 0x03) * 0x55;
+	case 4:  return ((row[i >> 1] >> (4 - 4 * (i & 1))) & 0x0f) * 0x11;
+	case 8:  return row[i];
+	default: return row[i * 2]; // 16-bit samples, keep the high byte
+	}
+}
+
+// read the i-th raw (unscaled) sample, for palette indices and transparency keys
+inline unsigned int rawSampleAt(const unsigned char* row, unsigned int i, unsigned int depth) {
+	switch (depth) {
+	case 1:  return (row[i >> 3] >> (7 - (i & 7))) & 0x01;
+	case 2:  return (row[i >> 2] >> (6 - 2 * (i & 3))) & 0x03;
+	case 4:  return (row[i >> 1] >> (4 - 4 * (i & 1))) & 0x0f;
+	case 8:  return row[i];
+	default: return (row[i * 2] << 8) | row[i * 2 + 1];
+	}
+}
+
+bool decodePNG(const bytes& data, image& out) {
+	static const unsigned char sig[] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+	if (data.size() < 8 || memcmp(&data[0], sig, sizeof(sig)) != 0) {
+		return false;
+	}
+
+	unsigned int  w = 0, h = 0;
+	unsigned char depth = 0, ctype = 0, interlace = 0;
+	bool          hasKey = false;
+	unsigned int  key[3] = { 0, 0, 0 };
+	value         palette[256];
+	bytes         zdata;
+
+	for (unsigned int i = 0; i < 256; ++i) {
+		palette[i] = make(0, 0, 0, 0xff);
+	}
+
+	size_t p = 8;
+	while (p + 12 <= data.size()) {
+		unsigned int         len = be32(&data[p]);
+		std::string          ct(data.begin() + p + 4, data.begin() + p + 8);
+		const unsigned char* cd  = &data[p + 8];
+
+		if (len > data.size() - p - 12) {
+			throw std::runtime_error("Truncated PNG chunk '" + ct + "'.");
+		}
+
+		if (ct == "IHDR" && len >= 13) {
+			w         = be32(cd);
+			h         = be32(cd + 4);
+			depth     = cd[8];
+			ctype     = cd[9];
+			interlace = cd[12];
+		} else if (ct == "PLTE") {
+			for (unsigned int i = 0; i < len / 3 && i < 256; ++i) {
+				palette[i] = make(cd[i * 3], cd[i * 3 + 1], cd[i * 3 + 2]);
+			}
+		} else if (ct == "tRNS") {
+			if (ctype == 3) {
+				for (unsigned int i = 0; i < len && i < 256; ++i) {
+					palette[i] = (palette[i] & 0xffffff00) | cd[i];
+				}
+			} else if (ctype == 0 && len >= 2) {
+				hasKey = true;
+				key[0] = (cd[0] << 8) | cd[1];
+			} else if (ctype == 2 && len >= 6) {
+				hasKey = true;
+				key[0] = (cd[0] << 8) | cd[1];
+				key[1] = (cd[2] << 8) | cd[3];
+				key[2] = (cd[4] << 8) | cd[5];
+			}
+		} else if (ct == "IDAT") {
+			zdata.insert(zdata.end(), cd, cd + len);
+		} else if (ct == "IEND") {
+			break;
+		}
+
+		p += len + 12;
+	}
+
+	// leave interlaced images to ImageMagick
+	if (interlace != 0) {
+		return false;
+	}
+
+	unsigned int channels = 0;
+	switch (ctype) {
+	case 0: channels = 1; break;
+	case 2: channels = 3; break;
+	case 3: channels = 1; break;
+	case 4: channels = 2; break;
+	case 6: channels = 4; break;
+	default: throw std::runtime_error("Invalid PNG color type #" + str::to_string(int(ctype)));
+	}
+
+	if (depth != 1 && depth != 2 && depth != 4 && depth != 8 && depth != 16) {
+		throw std::runtime_error("Invalid PNG bit depth: " + str::to_string(int(depth)));
+	}
+
+	allocImage(w, h, out);
+
+	unsigned int bitsPerPixel = channels * depth;
+	size_t       stride       = (size_t(w) * bitsPerPixel + 7) / 8;
+	unsigned int bpp          = (bitsPerPixel + 7) / 8;
+	bytes        raw((stride + 1) * h);
+
+	// inflate the concatenated IDAT stream
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (inflateInit(&zs) != Z_OK) {
+		throw std::runtime_error("Failed to initialize zlib for PNG decoding.");
+	}
+
+	zs.next_in   = zdata.empty() ? 0 : &zdata[0];
+	zs.avail_in  = zdata.size();
+	zs.next_out  = &raw[0];
+	zs.avail_out = raw.size();
+
+	int zr = inflate(&zs, Z_FINISH);
+	inflateEnd(&zs);
+	if ((zr != Z_STREAM_END && zr != Z_BUF_ERROR) || zs.avail_out != 0) {
+		throw std::runtime_error("Failed to inflate PNG image data.");
+	}
+
+	unfilterPNG(&raw[0], h, stride, bpp);
+
+	// finally expand each pixel to RGBA
+	for (unsigned int y = 0; y < h; ++y) {
+		const unsigned char* row = &raw[y * (stride + 1) + 1];
+		value*               px  = &out.data[size_t(y) * w];
+
+		for (unsigned int x = 0; x < w; ++x) {
+			switch (ctype) {
+			case 0: {
+				channel g = sampleAt(row, x, depth);
+				channel a = (hasKey && rawSampleAt(row, x, depth) == key[0]) ? 0x00 : 0xff;
+				px[x] = make(g, g, g, a);
+				break;
+			}
+			case 2: {
+				channel r = sampleAt(row, x * 3,     depth);
+				channel g = sampleAt(row, x * 3 + 1, depth);
+				channel b = sampleAt(row, x * 3 + 2, depth);
+				bool    k = hasKey && rawSampleAt(row, x * 3, depth) == key[0] && rawSampleAt(row, x * 3 + 1, depth) == key[1] && rawSampleAt(row, x * 3 + 2, depth) == key[2];
+				px[x] = make(r, g, b, k ? 0x00 : 0xff);
+				break;
+			}
+			case 3:
+				px[x] = palette[rawSampleAt(row, x, depth) & 0xff];
+				break;
+			case 4: {
+				channel g = sampleAt(row, x * 2, depth);
+				px[x] = make(g, g, g, sampleAt(row, x * 2 + 1, depth));
+				break;
+			}
+			case 6:
+				px[x] = make(sampleAt(row, x * 4, depth), sampleAt(row, x * 4 + 1, depth), sampleAt(row, x * 4 + 2, depth), sampleAt(row, x * 4 + 3, depth));
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * TGA
+ */
+inline unsigned int le16(const unsigned char* p) {
+	return p[0] | (p[1] << 8);
+}
+
+inline value tgaPixel(const unsigned char* p, unsigned int bytesPerPixel, bool gray) {
+	if (gray) {
+		return make(p[0], p[0], p[0], bytesPerPixel > 1 ? p[1] : 0xff);
+	}
+
+	switch (bytesPerPixel) {
+	case 2: {
+		unsigned int v = le16(p);
+		return make(((v >> 10) & 0x1f) * 255 / 31, ((v >> 5) & 0x1f) * 255 / 31, (v & 0x1f) * 255 / 31);
+	}
+	case 3:
+		return make(p[2], p[1], p[0]);
+	default:
+		return make(p[2], p[1], p[0], p[3]);
+	}
+}
+
+bool decodeTGA(const bytes& data, image& out) {
+	if (data.size() < 18) {
+		return false;
+	}
+
+	const unsigned char* hdr     = &data[0];
+	unsigned int         idlen   = hdr[0];
+	unsigned int         cmtype  = hdr[1];
+	unsigned int         itype   = hdr[2];
+	unsigned int         cmfirst = le16(hdr + 3);
+	unsigned int         cmlen   = le16(hdr + 5);
+	unsigned int         cmbits  = hdr[7];
+	unsigned int         w       = le16(hdr + 12);
+	unsigned int         h       = le16(hdr + 14);
+	unsigned int         bits    = hdr[16];
+	bool                 topDown = (hdr[17] & 0x20) != 0;
+
+	bool rle    = itype >= 9;
+	bool mapped = itype == 1 || itype == 9;
+	bool gray   = itype == 3 || itype == 11;
+	if (!mapped && !gray && itype != 2 && itype != 10) {
+		return false;
+	}
+
+	unsigned int bytesPerPixel = (bits + 7) / 8;
+	if (bytesPerPixel == 0 || bytesPerPixel > 4 || (mapped && bytesPerPixel > 2)) {
+		return false;
+	}
+
+	// read the color map (if any)
+	size_t p = 18 + idlen;
+	pixels cmap;
+	if (cmtype == 1) {
+		unsigned int cmBytes = (cmbits + 7) / 8;
+		if (cmBytes < 2 || cmBytes > 4 || p + size_t(cmlen) * cmBytes > data.size()) {
+			return false;
+		}
+
+		cmap.resize(cmfirst + cmlen, make(0, 0, 0, 0xff));
+		for (unsigned int i = 0; i < cmlen; ++i) {
+			cmap[cmfirst + i] = tgaPixel(&data[p + i * cmBytes], cmBytes, false);
+		}
+		p += size_t(cmlen) * cmBytes;
+	}
+
+	allocImage(w, h, out);
+
+	size_t n = size_t(w) * h;
+	size_t i = 0;
+	while (i < n) {
+		unsigned int run = 1;
+		bool         rep = false;
+
+		if (rle) {
+			if (p >= data.size()) break;
+			unsigned char c = data[p++];
+			run = (c & 0x7f) + 1;
+			rep = (c & 0x80) != 0;
+		}
+
+		for (unsigned int r = 0; r < run && i < n; ++r, ++i) {
+			if (p + bytesPerPixel > data.size()) {
+				throw std::runtime_error("Truncated TGA image data.");
+			}
+
+			const unsigned char* src = &data[p];
+			value                v   = 0;
+			if (mapped) {
+				unsigned int ci = bytesPerPixel == 1 ? src[0] : le16(src);
+				v = (ci < cmap.size()) ? cmap[ci] : make(0, 0, 0, 0xff);
+			} else {
+				v = tgaPixel(src, bytesPerPixel, gray);
+			}
+
+			size_t x = i % w;
+			size_t y = i / w;
+			out.data[(topDown ? y : (h - 1 - y)) * w + x] = v;
+
+			if (!rep || r + 1 == run) {
+				p += bytesPerPixel;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+ * PPM / PGM
+ */
+inline void skipPNMSpace(const bytes& data, size_t& p) {
+	while (p < data.size()) {
+		if (data[p] == '#') {
+			while (p < data.size() && data[p] != '\n') ++p;
+		} else if (str::is_whitespace<char>(data[p])) {
+			++p;
+		} else {
+			break;
+		}
+	}
+}
+
+inline unsigned int readPNMInt(const bytes& data, size_t& p) {
+	skipPNMSpace(data, p);
+	if (p >= data.size() || !str::is_numeric<char>(data[p])) {
+		throw std::runtime_error("Invalid PNM header.");
+	}
+
+	unsigned int result = 0;
+	while (p < data.size() && str::is_numeric<char>(data[p])) {
+		result = result * 10 + (data[p] - '0');
+		++p;
+	}
+	return result;
+}
+
+bool decodePNM(const bytes& data, image& out) {
+	if (data.size() < 3 || data[0] != 'P' || data[1] < '2' || data[1] > '6' || data[1] == '4') {
+		return false;
+	}
+
+	bool         ascii    = data[1] <= '3';
+	unsigned int channels = (data[1] == '3' || data[1] == '6') ? 3 : 1;
+
+	size_t       p      = 2;
+	unsigned int w      = readPNMInt(data, p);
+	unsigned int h      = readPNMInt(data, p);
+	unsigned int maxval = readPNMInt(data, p);
+	if (maxval == 0 || maxval > 0xffff) {
+		throw std::runtime_error("Invalid PNM maximum value: " + str::to_string(maxval));
+	}
+	++p; // a single whitespace character precedes binary data
+
+	allocImage(w, h, out);
+
+	unsigned int sampleBytes = maxval > 0xff ? 2 : 1;
+	size_t       n           = size_t(w) * h;
+	if (!ascii && p + n * channels * sampleBytes > data.size()) {
+		throw std::runtime_error("Truncated PNM image data.");
+	}
+
+	for (size_t i = 0; i < n; ++i) {
+		channel c[3] = { 0, 0, 0 };
+		for (unsigned int k = 0; k < channels; ++k) {
+			unsigned int s = 0;
+			if (ascii) {
+				s = readPNMInt(data, p);
+			} else if (sampleBytes == 2) {
+				s = (data[p] << 8) | data[p + 1];
+				p += 2;
+			} else {
+				s = data[p++];
+			}
+			c[k] = channel((std::min(s, maxval) * 255 + maxval / 2) / maxval);
+		}
+
+		out.data[i] = (channels == 3) ? make(c[0], c[1], c[2]) : make(c[0], c[0], c[0]);
+	}
+
+	return true;
+}
+
+}
+
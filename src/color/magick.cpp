@@ -0,0 +1,59 @@
+
+#include <color/decode.hpp>
+#include <Magick++.h>
+#include <string>
+#include <pthread.h>
+#include <sys/time.h>
+#include <string.h>
+
+namespace color {
+
+static std::string    magickPath;
+static pthread_once_t magickOnce = PTHREAD_ONCE_INIT;
+static double         magickMS   = 0.0;
+
+void deferMagickInit(const char* progpath) {
+	magickPath = progpath ? progpath : "";
+}
+
+// (images may be decoded on several threads, but ImageMagick is only initialized once)
+void startMagick() {
+	timeval t0, t1;
+	memset(&t0, 0, sizeof(t0));
+	memset(&t1, 0, sizeof(t1));
+
+	gettimeofday(&t0, 0);
+	Magick::InitializeMagick(magickPath.empty() ? 0 : magickPath.c_str());
+	gettimeofday(&t1, 0);
+
+	magickMS = double(t1.tv_sec - t0.tv_sec) * 1000.0 + double(t1.tv_usec - t0.tv_usec) / 1000.0;
+}
+
+void initMagick() {
+	pthread_once(&magickOnce, startMagick);
+}
+
+double magickInitTime() {
+	return magickMS;
+}
+
+void readMagick(const std::string& filename, image& out) {
+	initMagick();
+
+	Magick::Image img;
+	img.read(filename);
+
+	Magick::Geometry g = img.boundingBox();
+	out.width  = g.width();
+	out.height = g.height();
+	out.data.resize(size_t(out.width) * size_t(out.height));
+
+	const Magick::PixelPacket* ps = img.getConstPixels(0, 0, out.width, out.height);
+	for (size_t i = 0; i < out.data.size(); ++i) {
+		const Magick::PixelPacket* p = ps + i;
+		out.data[i] = color::make(p->red, p->green, p->blue, 0xff - p->opacity);
+	}
+}
+
+}
+
@@ -0,0 +1,62 @@
+
+#include <color/resize.hpp>
+#include <par/pool.hpp>
+#include <algorithm>
+
+namespace color {
+
+void boxFilter(const image& src, unsigned int w, unsigned int h, unsigned int y0, unsigned int y1, value* out) {
+	for (unsigned int y = y0; y < y1; ++y) {
+		unsigned int sy0, sy1;
+		box(y, h, src.height, sy0, sy1);
+
+		for (unsigned int x = 0; x < w; ++x, ++out) {
+			unsigned int sx0, sx1;
+			box(x, w, src.width, sx0, sx1);
+
+			unsigned long r = 0, g = 0, b = 0, a = 0;
+			for (unsigned int sy = sy0; sy < sy1; ++sy) {
+				const value* p = &src.data[size_t(sy) * src.width];
+				for (unsigned int sx = sx0; sx < sx1; ++sx) {
+					value c = p[sx];
+					r += red(c);
+					g += green(c);
+					b += blue(c);
+					a += alpha(c);
+				}
+			}
+
+			unsigned long n = (unsigned long)(sy1 - sy0) * (sx1 - sx0);
+			*out = make(channel(r / n), channel(g / n), channel(b / n), channel(a / n));
+		}
+	}
+}
+
+struct filterRows {
+	const image* src;
+	unsigned int w;
+	unsigned int h;
+	value*       out;
+
+	void operator()(unsigned int y) {
+		boxFilter(*src, w, h, y, y + 1, out + size_t(y) * w);
+	}
+};
+
+void resize(const image& src, unsigned int w, unsigned int h, image& out) {
+	out.width  = w;
+	out.height = h;
+	out.data.resize(size_t(w) * h);
+
+	if (w > 0 && h > 0) {
+		filterRows f;
+		f.src = &src;
+		f.w   = w;
+		f.h   = h;
+		f.out = &out.data[0];
+		par::each(h, f);
+	}
+}
+
+}
+
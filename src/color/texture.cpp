@@ -1,24 +1,37 @@
 
 #include <color/data.hpp>
 #include <color/texture.hpp>
+#include <color/cache.hpp>
+#include <math.h>
 
 namespace color {
 
-texture::texture(const std::string& filename) {
+texture::texture(const std::string& filename) : cx(0), cy(0), kd(color::make(0xff, 0xff, 0xff, 0xff)) {
 	load(filename);
 }
 
-texture::texture() : cx(0), cy(0), pixels(0) {
+texture::texture() : cx(0), cy(0), kd(color::make(0xff, 0xff, 0xff, 0xff)) {
 }
 
 void texture::load(const std::string& filename) {
-	this->image.read(filename);
+	image img;
+	color::readCached(filename, img);
 
-	Magick::Geometry g = this->image.boundingBox();
-	this->cx = g.width();
-	this->cy = g.height();
+	this->cx = img.width;
+	this->cy = img.height;
+	this->texels.swap(img.data);
+}
+
+void texture::fill(color::value c) {
+	this->kd = c;
+}
+
+bool texture::flat() const {
+	return this->texels.empty();
+}
 
-	this->pixels = this->image.getConstPixels(0, 0, this->cx, this->cy);
+color::value texture::flatColor() const {
+	return this->kd;
 }
 
 unsigned int texture::width() const {
@@ -56,13 +69,12 @@ color::value texture::texel(double u, double v) const {
 }
 
 color::value texture::texel(int tx, int ty) const {
-	if (this->pixels) {
+	if (!this->texels.empty()) {
 		tx = tx % this->cx;
-		ty = this->cy - (ty % this->cy);
-		const Magick::PixelPacket* p = this->pixels + tx + ty * this->cx;
-		return color::make(p->red, p->green, p->blue, 0xff - p->opacity);
+		ty = (this->cy - (ty % this->cy)) % this->cy;
+		return this->texels[tx + ty * this->cx];
 	} else {
-		return color::make(0xff, 0xff, 0xff, 0xff);
+		return this->kd;
 	}
 }
 
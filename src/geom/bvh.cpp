@@ -0,0 +1,193 @@
+
+#include <geom/bvh.hpp>
+#include <algorithm>
+#include <math.h>
+
+namespace geom {
+
+static const unsigned int leafSize = 4;
+
+// clusters at least this many radii away from a query are approximated by their dipole
+static const double farRatio = 2.0;
+
+/*
+ * box
+ */
+box::box() : x0(HUGE_VAL), y0(HUGE_VAL), z0(HUGE_VAL), x1(-HUGE_VAL), y1(-HUGE_VAL), z1(-HUGE_VAL) {
+}
+
+box::box(double x0, double y0, double z0, double x1, double y1, double z1) : x0(x0), y0(y0), z0(z0), x1(x1), y1(y1), z1(z1) {
+}
+
+void box::add(const point& p) {
+	x0 = std::min(x0, p.x); y0 = std::min(y0, p.y); z0 = std::min(z0, p.z);
+	x1 = std::max(x1, p.x); y1 = std::max(y1, p.y); z1 = std::max(z1, p.z);
+}
+
+void box::add(const box& b) {
+	x0 = std::min(x0, b.x0); y0 = std::min(y0, b.y0); z0 = std::min(z0, b.z0);
+	x1 = std::max(x1, b.x1); y1 = std::max(y1, b.y1); z1 = std::max(z1, b.z1);
+}
+
+bool box::overlaps(const box& b) const {
+	return x0 <= b.x1 && b.x0 <= x1 && y0 <= b.y1 && b.y0 <= y1 && z0 <= b.z1 && b.z0 <= z1;
+}
+
+/*
+ * bvh
+ */
+inline double centroid(const triangle& t, int axis) {
+	switch (axis) {
+	case 0:  return t.p0.x + t.p1.x + t.p2.x;
+	case 1:  return t.p0.y + t.p1.y + t.p2.y;
+	default: return t.p0.z + t.p1.z + t.p2.z;
+	}
+}
+
+struct byCentroid {
+	const std::vector<triangle>* tris;
+	int                          axis;
+
+	bool operator()(unsigned int a, unsigned int b) const {
+		return centroid((*tris)[a], axis) < centroid((*tris)[b], axis);
+	}
+};
+
+bvh::bvh(const std::vector<triangle>& tris) : tris(tris), order(tris.size()) {
+	for (unsigned int i = 0; i < this->order.size(); ++i) {
+		this->order[i] = i;
+	}
+
+	if (!tris.empty()) {
+		this->ns.reserve(2 * (tris.size() / leafSize + 1));
+		build(0, tris.size());
+	}
+}
+
+// build the subtree over order[first, first+count), split at the median along its longest axis
+unsigned int bvh::build(unsigned int first, unsigned int count) {
+	unsigned int n = this->ns.size();
+	this->ns.push_back(node());
+
+	box    b;
+	double ax = 0.0, ay = 0.0, az = 0.0; // area-weighted normal (its length is twice the area)
+	double cx = 0.0, cy = 0.0, cz = 0.0; // area-weighted centroid
+	double area = 0.0;
+
+	for (unsigned int i = first; i < first + count; ++i) {
+		const triangle& t = this->tris[this->order[i]];
+		b.add(t.p0); b.add(t.p1); b.add(t.p2);
+
+		double ux = t.p1.x - t.p0.x, uy = t.p1.y - t.p0.y, uz = t.p1.z - t.p0.z;
+		double vx = t.p2.x - t.p0.x, vy = t.p2.y - t.p0.y, vz = t.p2.z - t.p0.z;
+		double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+		double a  = 0.5 * sqrt(nx * nx + ny * ny + nz * nz);
+
+		ax += 0.5 * nx; ay += 0.5 * ny; az += 0.5 * nz;
+		cx += a * (t.p0.x + t.p1.x + t.p2.x) / 3.0;
+		cy += a * (t.p0.y + t.p1.y + t.p2.y) / 3.0;
+		cz += a * (t.p0.z + t.p1.z + t.p2.z) / 3.0;
+		area += a;
+	}
+
+	if (area > 0.0) {
+		cx /= area; cy /= area; cz /= area;
+	} else {
+		cx = 0.5 * (b.x0 + b.x1); cy = 0.5 * (b.y0 + b.y1); cz = 0.5 * (b.z0 + b.z1);
+	}
+
+	// the radius reaches the farthest box corner from the centroid
+	double rx = std::max(cx - b.x0, b.x1 - cx), ry = std::max(cy - b.y0, b.y1 - cy), rz = std::max(cz - b.z0, b.z1 - cz);
+
+	node& nd  = this->ns[n];
+	nd.bounds = b;
+	nd.first  = first;
+	nd.count  = count;
+	nd.right  = 0;
+	nd.cx = cx; nd.cy = cy; nd.cz = cz;
+	nd.nx = ax; nd.ny = ay; nd.nz = az;
+	nd.radius = sqrt(rx * rx + ry * ry + rz * rz);
+
+	if (count > leafSize) {
+		byCentroid cmp;
+		cmp.tris = &this->tris;
+		cmp.axis = (b.x1 - b.x0 >= b.y1 - b.y0 && b.x1 - b.x0 >= b.z1 - b.z0) ? 0 : (b.y1 - b.y0 >= b.z1 - b.z0) ? 1 : 2;
+
+		unsigned int half = count / 2;
+		std::nth_element(this->order.begin() + first, this->order.begin() + first + half, this->order.begin() + first + count, cmp);
+
+		build(first, half);
+		unsigned int r = build(first + half, count - half);
+
+		this->ns[n].count = 0;
+		this->ns[n].right = r;
+	}
+
+	return n;
+}
+
+// the solid angle of a triangle seen from the origin (van Oosterom and Strackee)
+inline double solidAngle(double ax, double ay, double az, double bx, double by, double bz, double cx, double cy, double cz) {
+	double la = sqrt(ax * ax + ay * ay + az * az);
+	double lb = sqrt(bx * bx + by * by + bz * bz);
+	double lc = sqrt(cx * cx + cy * cy + cz * cz);
+
+	double det = ax * (by * cz - bz * cy) - ay * (bx * cz - bz * cx) + az * (bx * cy - by * cx);
+	double div = la * lb * lc + (ax * bx + ay * by + az * bz) * lc + (ax * cx + ay * cy + az * cz) * lb + (bx * cx + by * cy + bz * cz) * la;
+
+	return 2.0 * atan2(det, div);
+}
+
+double bvh::winding(double x, double y, double z) const {
+	return this->ns.empty() ? 0.0 : winding(0, x, y, z) / (4.0 * M_PI);
+}
+
+// (the sum of solid angles under node n)
+double bvh::winding(unsigned int n, double x, double y, double z) const {
+	const node& nd = this->ns[n];
+
+	double dx = nd.cx - x, dy = nd.cy - y, dz = nd.cz - z;
+	double d2 = dx * dx + dy * dy + dz * dz;
+
+	if (d2 > farRatio * farRatio * nd.radius * nd.radius) {
+		// far enough away to treat the cluster as a dipole
+		return (dx * nd.nx + dy * nd.ny + dz * nd.nz) / (d2 * sqrt(d2));
+	} else if (nd.count == 0) {
+		return winding(n + 1, x, y, z) + winding(nd.right, x, y, z);
+	}
+
+	double s = 0.0;
+	for (unsigned int i = nd.first; i < nd.first + nd.count; ++i) {
+		const triangle& t = this->tris[this->order[i]];
+		s += solidAngle(t.p0.x - x, t.p0.y - y, t.p0.z - z, t.p1.x - x, t.p1.y - y, t.p1.z - z, t.p2.x - x, t.p2.y - y, t.p2.z - z);
+	}
+	return s;
+}
+
+bool bvh::overlaps(const box& b) const {
+	return !this->ns.empty() && overlaps(0, b);
+}
+
+bool bvh::overlaps(unsigned int n, const box& b) const {
+	const node& nd = this->ns[n];
+
+	if (!nd.bounds.overlaps(b)) {
+		return false;
+	} else if (nd.count == 0) {
+		return overlaps(n + 1, b) || overlaps(nd.right, b);
+	}
+
+	for (unsigned int i = nd.first; i < nd.first + nd.count; ++i) {
+		const triangle& t = this->tris[this->order[i]];
+
+		box tb;
+		tb.add(t.p0); tb.add(t.p1); tb.add(t.p2);
+		if (tb.overlaps(b)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
+
@@ -0,0 +1,107 @@
+
+#include <geom/downsample.hpp>
+#include <color/resize.hpp>
+#include <par/pool.hpp>
+
+namespace geom {
+
+struct filterSlabs {
+	const volume* v;
+	unsigned int  w, h, d;
+	unsigned int  minFill;
+	color::value* out;
+
+	void operator()(unsigned int y) {
+		unsigned int sw = v->width();
+		unsigned int sh = v->height();
+		unsigned int sd = v->depth();
+
+		// per-voxel channel sums and occupied counts for this slab
+		size_t                     n = size_t(w) * d;
+		std::vector<unsigned long> sums(4 * n, 0);
+		std::vector<unsigned int>  counts(n, 0);
+		std::vector<color::value>  row(sw);
+
+		// (voxel x boundaries are the same for every row)
+		std::vector<unsigned int> xOf(sw);
+		for (unsigned int x = 0; x < w; ++x) {
+			unsigned int sx0, sx1;
+			color::box(x, w, sw, sx0, sx1);
+			for (unsigned int sx = sx0; sx < sx1 && sx < sw; ++sx) {
+				xOf[sx] = x;
+			}
+		}
+
+		unsigned int sy0, sy1;
+		color::box(y, h, sh, sy0, sy1);
+
+		for (unsigned int z = 0; z < d; ++z) {
+			unsigned int sz0, sz1;
+			color::box(z, d, sd, sz0, sz1);
+
+			for (unsigned int sy = sy0; sy < sy1; ++sy) {
+				for (unsigned int sz = sz0; sz < sz1; ++sz) {
+					v->readRow(0, sy, sz, sw, &row[0]);
+
+					for (unsigned int sx = 0; sx < sw; ++sx) {
+						color::value c = row[sx];
+						if (color::alpha(c) == 0) {
+							continue;
+						}
+
+						size_t i = size_t(z) * w + xOf[sx];
+						sums[4 * i + 0] += color::red(c);
+						sums[4 * i + 1] += color::green(c);
+						sums[4 * i + 2] += color::blue(c);
+						sums[4 * i + 3] += color::alpha(c);
+						++counts[i];
+					}
+				}
+			}
+		}
+
+		color::value* slab = out + n * y;
+		for (size_t i = 0; i < n; ++i) {
+			unsigned long c = counts[i];
+			if (c == 0 || c < minFill) {
+				slab[i] = color::make(0, 0, 0, 0);
+			} else {
+				slab[i] = color::make(color::channel(sums[4 * i] / c), color::channel(sums[4 * i + 1] / c), color::channel(sums[4 * i + 2] / c), color::channel(sums[4 * i + 3] / c));
+			}
+		}
+	}
+};
+
+downsample::downsample(const volume& v, unsigned int w, unsigned int h, unsigned int d, unsigned int minFill) : w(w), h(h), d(d), data(size_t(w) * h * d) {
+	if (w == 0 || h == 0 || d == 0) {
+		return;
+	}
+
+	filterSlabs f;
+	f.v       = &v;
+	f.w       = w;
+	f.h       = h;
+	f.d       = d;
+	f.minFill = minFill;
+	f.out     = &this->data[0];
+	par::each(h, f);
+}
+
+unsigned int downsample::width()  const { return this->w; }
+unsigned int downsample::height() const { return this->h; }
+unsigned int downsample::depth()  const { return this->d; }
+
+color::value downsample::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	if (x >= this->w || y >= this->h || z >= this->d) {
+		return color::make(0, 0, 0, 0);
+	} else {
+		return this->data[(size_t(y) * this->d + z) * this->w + x];
+	}
+}
+
+void downsample::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	readDenseRow(this->data.empty() ? 0 : &this->data[0], this->w, this->h, this->d, x, y, z, n, out);
+}
+
+}
+
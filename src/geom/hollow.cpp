@@ -0,0 +1,257 @@
+
+#include <geom/hollow.hpp>
+#include <par/pool.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+namespace geom {
+
+// (occupied voxels start out with no known distance)
+static const unsigned int unreached = ~0u;
+
+// the squared distance along a line of n samples (each already a squared distance in the
+// other axes) to the nearest empty voxel, taking the voxels just past both ends to be empty
+//
+//   this is the lower envelope of the parabolas rooted at each sample (Felzenszwalb &
+//   Huttenlocher), with sites at -1 and n for the ends
+struct lineTransform {
+	std::vector<unsigned int> f;
+	std::vector<unsigned int> out;    // (the envelope is read from 'f' until the very end, so it's evaluated in here)
+	std::vector<int>          sites;
+	std::vector<double>       bounds;
+
+	lineTransform(unsigned int n) : f(n), out(n), sites(n + 2), bounds(n + 3) {
+	}
+
+	double at(int p) const {
+		return (p < 0 || p >= int(this->f.size())) ? 0.0 : double(this->f[p]);
+	}
+
+	// transform the line in 'f' (into 'f')
+	void apply() {
+		int n = int(this->f.size());
+		int k = 0;
+
+		this->sites[0]  = -1;
+		this->bounds[0] = -1e30;
+		this->bounds[1] = 1e30;
+
+		for (int q = 0; q <= n; ++q) {
+			if (q < n && this->f[q] == unreached) {
+				continue;
+			}
+
+			double fq = at(q);
+			double s  = 0.0;
+			while (true) {
+				int p = this->sites[k];
+				s = ((fq + double(q) * q) - (at(p) + double(p) * p)) / (2.0 * (q - p));
+				if (s <= this->bounds[k]) {
+					--k;
+				} else {
+					break;
+				}
+			}
+
+			++k;
+			this->sites[k]      = q;
+			this->bounds[k]     = s;
+			this->bounds[k + 1] = 1e30;
+		}
+
+		k = 0;
+		for (int q = 0; q < n; ++q) {
+			while (this->bounds[k + 1] < q) {
+				++k;
+			}
+			int p = this->sites[k];
+			this->out[q] = (unsigned int)((q - p) * (q - p) + at(p));
+		}
+
+#ifdef DEBUG
+		check();
+#endif
+		this->f.swap(this->out);
+	}
+
+#ifdef DEBUG
+	// (debug builds compare every line against the nearest site found the slow way)
+	void check() const {
+		int n = int(this->f.size());
+		for (int q = 0; q < n; ++q) {
+			double best = double(std::min(q + 1, n - q)) * std::min(q + 1, n - q);
+			for (int p = 0; p < n; ++p) {
+				if (this->f[p] != unreached) {
+					best = std::min(best, double(q - p) * (q - p) + at(p));
+				}
+			}
+			if (double(this->out[q]) != best) {
+				throw std::runtime_error("The distance transform went wrong while hollowing.");
+			}
+		}
+	}
+#endif
+};
+
+// the first pass marks occupied voxels, and finds distances along x (for each z row of a y slab)
+struct transformRows {
+	const volume*  v;
+	unsigned int*  out;
+	par::progress* prog;
+
+	void operator()(unsigned int y) {
+		unsigned int w = v->width();
+		unsigned int d = v->depth();
+
+		lineTransform line(w);
+		std::vector<color::value> row(w);
+
+		for (unsigned int z = 0; z < d; ++z) {
+			v->readRow(0, y, z, w, &row[0]);
+			for (unsigned int x = 0; x < w; ++x) {
+				line.f[x] = color::alpha(row[x]) == 0 ? 0 : unreached;
+			}
+
+			line.apply();
+			std::copy(line.f.begin(), line.f.end(), out + (size_t(y) * d + z) * w);
+		}
+
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+};
+
+// then along z (for each x of a y slab)
+struct transformDepths {
+	unsigned int   w, d;
+	unsigned int*  data;
+	par::progress* prog;
+
+	void operator()(unsigned int y) {
+		lineTransform line(d);
+		unsigned int* slab = data + size_t(y) * d * w;
+
+		for (unsigned int x = 0; x < w; ++x) {
+			for (unsigned int z = 0; z < d; ++z) {
+				line.f[z] = slab[size_t(z) * w + x];
+			}
+			line.apply();
+			for (unsigned int z = 0; z < d; ++z) {
+				slab[size_t(z) * w + x] = line.f[z];
+			}
+		}
+
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+};
+
+// and finally along y (for each x of a z row)
+struct transformColumns {
+	unsigned int   w, h, d;
+	unsigned int*  data;
+	par::progress* prog;
+
+	void operator()(unsigned int z) {
+		lineTransform line(h);
+		size_t        stride = size_t(d) * w;
+
+		for (unsigned int x = 0; x < w; ++x) {
+			unsigned int* col = data + size_t(z) * w + x;
+			for (unsigned int y = 0; y < h; ++y) {
+				line.f[y] = col[y * stride];
+			}
+			line.apply();
+			for (unsigned int y = 0; y < h; ++y) {
+				col[y * stride] = line.f[y];
+			}
+		}
+
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+};
+
+hollow::hollow(const volume& v, unsigned int thickness, par::progress* prog) : v(v), maxDistSq(thickness * thickness), distSq(size_t(v.width()) * v.height() * v.depth()) {
+	unsigned int w = v.width();
+	unsigned int h = v.height();
+	unsigned int d = v.depth();
+	if (w == 0 || h == 0 || d == 0) {
+		return;
+	}
+
+	if (prog) {
+		prog->begin("Hollowing", 2 * h + d);
+	}
+
+	transformRows rows;
+	rows.v    = &v;
+	rows.out  = &this->distSq[0];
+	rows.prog = prog;
+	par::each(h, rows);
+
+	transformDepths depths;
+	depths.w    = w;
+	depths.d    = d;
+	depths.data = &this->distSq[0];
+	depths.prog = prog;
+	par::each(h, depths);
+
+	transformColumns cols;
+	cols.w    = w;
+	cols.h    = h;
+	cols.d    = d;
+	cols.data = &this->distSq[0];
+	cols.prog = prog;
+	par::each(d, cols);
+}
+
+unsigned int hollow::width()  const { return this->v.width(); }
+unsigned int hollow::height() const { return this->v.height(); }
+unsigned int hollow::depth()  const { return this->v.depth(); }
+
+bool hollow::kept(unsigned int x, unsigned int y, unsigned int z) const {
+	unsigned int ds = this->distSq[(size_t(y) * depth() + z) * width() + x];
+	return ds > 0 && ds <= this->maxDistSq;
+}
+
+color::value hollow::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	if (x >= width() || y >= height() || z >= depth() || !kept(x, y, z)) {
+		return color::make(0, 0, 0, 0);
+	} else {
+		return this->v.voxel(x, y, z);
+	}
+}
+
+void hollow::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	this->v.readRow(x, y, z, n, out);
+
+	unsigned int k = (x < width() && y < height() && z < depth()) ? std::min(n, width() - x) : 0;
+	for (unsigned int i = 0; i < k; ++i) {
+		if (!kept(x + i, y, z)) {
+			out[i] = color::make(0, 0, 0, 0);
+		}
+	}
+}
+
+void hollow::rowSpans(unsigned int y, unsigned int z, spans& out) const {
+	unsigned int w = width();
+
+	out.clear();
+	for (unsigned int x = 0; x < w;) {
+		if (!kept(x, y, z)) {
+			++x;
+		} else {
+			unsigned int x0 = x;
+			while (x < w && kept(x, y, z)) {
+				++x;
+			}
+			out.push_back(span(x0, x - x0));
+		}
+	}
+}
+
+}
@@ -29,7 +29,19 @@ triangle triangle::operator-(const point& rhs) const {
 
 color::value triangle::color(double u, double v) const {
 	if (this->texture) {
-		return this->texture->texel(u, v);
+		return this->texture->flat() ? this->texture->flatColor() : this->texture->texel(u, v);
+	} else {
+		return color::make(0xff, 0xff, 0xff, 0xff);
+	}
+}
+
+bool triangle::flat() const {
+	return this->texture == 0 || this->texture->flat();
+}
+
+color::value triangle::flatColor() const {
+	if (this->texture) {
+		return this->texture->flatColor();
 	} else {
 		return color::make(0xff, 0xff, 0xff, 0xff);
 	}
@@ -1,9 +1,137 @@
-
 #include <geom/voxel.hpp>
+#include <algorithm>
+#include <string.h>
 
 namespace geom {
 
+span::span(unsigned int x, unsigned int n) : x(x), n(n) {
+}
+
+/*
+ * volume
+ */
 volume::~volume() { }
 
+void volume::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	for (unsigned int i = 0; i < n; ++i) {
+		out[i] = voxel(x + i, y, z);
+	}
+}
+
+void volume::readSlab(unsigned int y, color::value* out) const {
+	unsigned int w = width();
+	unsigned int d = depth();
+
+	for (unsigned int z = 0; z < d; ++z) {
+		readRow(0, y, z, w, out + size_t(w) * z);
+	}
+}
+
+void volume::rowSpans(unsigned int y, unsigned int z, spans& out) const {
+	unsigned int              w = width();
+	std::vector<color::value> row(w);
+	readRow(0, y, z, w, &row[0]);
+
+	out.clear();
+	for (unsigned int x = 0; x < w;) {
+		if (color::alpha(row[x]) == 0) {
+			++x;
+		} else {
+			unsigned int x0 = x;
+			while (x < w && color::alpha(row[x]) != 0) {
+				++x;
+			}
+			out.push_back(span(x0, x - x0));
+		}
+	}
+}
+
+void readDenseRow(const color::value* data, unsigned int w, unsigned int h, unsigned int d, unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) {
+	unsigned int k = (x < w && y < h && z < d) ? std::min(n, w - x) : 0;
+
+	if (k > 0) {
+		memcpy(out, data + (size_t(y) * d + z) * w + x, k * sizeof(color::value));
+	}
+	for (unsigned int i = k; i < n; ++i) {
+		out[i] = color::make(0, 0, 0, 0);
+	}
+}
+
+/*
+ * subvolume
+ */
+subvolume::subvolume(const volume& v, unsigned int x0, unsigned int y0, unsigned int z0, unsigned int w, unsigned int h, unsigned int d) : v(v), x0(x0), y0(y0), z0(z0), w(w), h(h), d(d) {
+}
+
+unsigned int subvolume::width()  const { return this->w; }
+unsigned int subvolume::height() const { return this->h; }
+unsigned int subvolume::depth()  const { return this->d; }
+
+color::value subvolume::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	return this->v.voxel(this->x0 + x, this->y0 + y, this->z0 + z);
+}
+
+void subvolume::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	this->v.readRow(this->x0 + x, this->y0 + y, this->z0 + z, n, out);
+}
+
+// (the spans of the whole row in the outer volume, clipped to this box)
+void subvolume::rowSpans(unsigned int y, unsigned int z, spans& out) const {
+	spans vs;
+	this->v.rowSpans(this->y0 + y, this->z0 + z, vs);
+
+	out.clear();
+	for (spans::const_iterator s = vs.begin(); s != vs.end(); ++s) {
+		unsigned int sx0 = std::max(s->x, this->x0);
+		unsigned int sx1 = std::min(s->x + s->n, this->x0 + this->w);
+
+		if (sx0 < sx1) {
+			out.push_back(span(sx0 - this->x0, sx1 - sx0));
+		}
+	}
+}
+
+/*
+ * runs
+ */
+runs::runs(const volume& v) : v(v), ry(0), rz(0), i(0) {
+	if (v.height() > 0 && v.depth() > 0) {
+		v.rowSpans(0, 0, this->row);
+	}
+	seek();
+}
+
+bool runs::done() const {
+	return this->ry >= this->v.height() || this->v.depth() == 0;
 }
 
+void runs::operator++() {
+	++this->i;
+	seek();
+}
+
+const span& runs::point() const {
+	return this->row[this->i];
+}
+
+unsigned int runs::y() const { return this->ry; }
+unsigned int runs::z() const { return this->rz; }
+
+// move on to the next row with spans left in it (if we've finished this one)
+void runs::seek() {
+	while (this->i >= this->row.size() && !done()) {
+		this->i = 0;
+		if (++this->rz >= this->v.depth()) {
+			this->rz = 0;
+			++this->ry;
+		}
+
+		if (done()) {
+			this->row.clear();
+		} else {
+			this->v.rowSpans(this->ry, this->rz, this->row);
+		}
+	}
+}
+
+}
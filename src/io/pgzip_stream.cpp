@@ -0,0 +1,247 @@
+
+#include <io/pgzip_stream.hpp>
+#include <par/pool.hpp>
+#include <str/Util.hpp>
+#include <stdexcept>
+#include <string.h>
+
+namespace io {
+
+// deflate uses (at most) a 32K window, so that's all the history a block needs from its predecessor
+static const size_t windowSize = 32 * 1024;
+
+int deflateStrategy(const std::string& name) {
+	if (name == "default")  return Z_DEFAULT_STRATEGY;
+	if (name == "filtered") return Z_FILTERED;
+	if (name == "huffman")  return Z_HUFFMAN_ONLY;
+	if (name == "rle")      return Z_RLE;
+	if (name == "fixed")    return Z_FIXED;
+
+	throw std::runtime_error("Unknown compression strategy: " + name);
+}
+
+// compress one block of a batch (independently of the others, except for its dictionary)
+struct deflateBlocks {
+	std::vector<pgzip_ostream_buffer::block>* bs;
+	const std::vector<char>*                  window;
+	deflate_options                           z;
+
+	void operator()(unsigned int i) {
+		pgzip_ostream_buffer::block& b = (*bs)[i];
+
+		b.crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef*)&b.input[0], b.size);
+
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		if (deflateInit2(&zs, z.level, Z_DEFLATED, -15, 8, z.strategy) != Z_OK) {
+			throw std::runtime_error("Failed to initialize zlib for block compression.");
+		}
+
+		// prime this block with the tail of the one before it
+		const char* dict  = 0;
+		size_t      dictN = 0;
+		if (i > 0) {
+			const pgzip_ostream_buffer::block& p = (*bs)[i - 1];
+			dictN = std::min(p.size, windowSize);
+			dict  = &p.input[p.size - dictN];
+		} else {
+			dictN = window->size();
+			dict  = dictN > 0 ? &(*window)[0] : 0;
+		}
+
+		if (dictN > 0) {
+			deflateSetDictionary(&zs, (const Bytef*)dict, dictN);
+		}
+
+		// non-final blocks end on a byte boundary (with an empty stored block) so that they can just be concatenated
+		b.output.resize(deflateBound(&zs, b.size) + 16);
+		zs.next_in  = (Bytef*)(b.size > 0 ? &b.input[0] : 0);
+		zs.avail_in = b.size;
+
+		int flush = b.last ? Z_FINISH : Z_SYNC_FLUSH;
+		int zr    = Z_OK;
+		do {
+			size_t done = zs.total_out;
+			if (done == b.output.size()) {
+				b.output.resize(b.output.size() * 2);
+			}
+			zs.next_out  = (Bytef*)&b.output[done];
+			zs.avail_out = b.output.size() - done;
+
+			zr = deflate(&zs, flush);
+		} while (zr == Z_OK && (zs.avail_out == 0 || zs.avail_in > 0));
+
+		b.output.resize(zs.total_out);
+		deflateEnd(&zs);
+
+		if (zr != Z_OK && zr != Z_STREAM_END && zr != Z_BUF_ERROR) {
+			throw std::runtime_error("Failed to compress a block of gzip output.");
+		}
+	}
+};
+
+pgzip_ostream_buffer::pgzip_ostream_buffer(const std::string& fname, const deflate_options& z, size_t blockSize) : fname(fname), z(z), used(0), crc(crc32(0L, Z_NULL, 0)), total(0), closed(false) {
+	if (z.level != Z_DEFAULT_COMPRESSION && (z.level < 0 || z.level > 9)) {
+		throw std::runtime_error("Invalid compression level: " + str::to_string(z.level));
+	}
+
+	this->file = fopen(fname.c_str(), "wb");
+	if (this->file == 0) {
+		throw std::runtime_error("Unable to open the gzip file '" + fname + "' for writing.");
+	}
+
+	// compress a couple of blocks per thread at a time, so that no thread sits idle for long
+	this->pending.resize(2 * par::threads());
+	for (blocks::iterator b = this->pending.begin(); b != this->pending.end(); ++b) {
+		b->input.resize(std::max<size_t>(blockSize, windowSize));
+		b->size = 0;
+		b->crc  = 0;
+		b->last = false;
+	}
+
+	// the gzip header (no name, no timestamp)
+	unsigned char xfl = (z.level == 9) ? 2 : (z.level == 1) ? 4 : 0;
+	const char hdr[] = { 0x1f, char(0x8b), Z_DEFLATED, 0, 0, 0, 0, 0, char(xfl), 3 };
+	put(hdr, sizeof(hdr));
+
+	char* b = &this->pending[0].input[0];
+	setp(b, b + this->pending[0].input.size());
+}
+
+pgzip_ostream_buffer::~pgzip_ostream_buffer() {
+	try {
+		close();
+	} catch (...) {
+	}
+
+	if (this->file) {
+		fclose(this->file);
+	}
+}
+
+void pgzip_ostream_buffer::close() {
+	if (this->closed) {
+		return;
+	}
+	this->closed = true;
+
+	this->pending[this->used].size = pptr() - pbase();
+	compress(true);
+
+	// the gzip trailer
+	unsigned char tr[8];
+	for (unsigned int i = 0; i < 4; ++i) {
+		tr[i]     = (unsigned char)((this->crc   >> (8 * i)) & 0xff);
+		tr[i + 4] = (unsigned char)((this->total >> (8 * i)) & 0xff);
+	}
+	put((const char*)tr, sizeof(tr));
+
+	FILE* f = this->file;
+	this->file = 0;
+	if (fclose(f) != 0) {
+		throw std::runtime_error("Failed to finish writing the gzip file '" + this->fname + "'.");
+	}
+}
+
+// move on to the next block, compressing the whole batch once they're all full
+void pgzip_ostream_buffer::nextBlock() {
+	this->pending[this->used].size = pptr() - pbase();
+
+	if (this->used + 1 == this->pending.size()) {
+		compress(false);
+	} else {
+		++this->used;
+	}
+
+	char* b = &this->pending[this->used].input[0];
+	setp(b, b + this->pending[this->used].input.size());
+}
+
+// compress blocks [0, used] and write them out in order
+void pgzip_ostream_buffer::compress(bool finish) {
+	unsigned int n = this->used + 1;
+	this->pending[this->used].last = finish;
+
+	deflateBlocks f;
+	f.bs     = &this->pending;
+	f.window = &this->window;
+	f.z      = this->z;
+	par::each(n, f);
+
+	for (unsigned int i = 0; i < n; ++i) {
+		const block& b = this->pending[i];
+		put(b.output.empty() ? 0 : &b.output[0], b.output.size());
+		this->crc    = crc32_combine(this->crc, b.crc, b.size);
+		this->total += b.size;
+	}
+
+	// keep the last 32K of history for the next batch (only the final block can be shorter than that)
+	const block& lb = this->pending[n - 1];
+	size_t       wn = std::min(lb.size, windowSize);
+	this->window.assign(lb.input.begin() + (lb.size - wn), lb.input.begin() + lb.size);
+
+	for (unsigned int i = 0; i < n; ++i) {
+		this->pending[i].output.clear();
+		this->pending[i].size = 0;
+		this->pending[i].last = false;
+	}
+	this->used = 0;
+}
+
+void pgzip_ostream_buffer::put(const char* data, size_t n) {
+	if (n > 0 && fwrite(data, 1, n, this->file) != n) {
+		throw std::runtime_error("Failed to write to the gzip file '" + this->fname + "'.");
+	}
+}
+
+pgzip_ostream_buffer::int_type pgzip_ostream_buffer::overflow(int_type c) {
+	if (this->closed) {
+		return traits_type::eof();
+	}
+
+	if (pptr() == epptr()) {
+		nextBlock();
+	}
+
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+
+	return traits_type::not_eof(c);
+}
+
+std::streamsize pgzip_ostream_buffer::xsputn(const char* src, std::streamsize n) {
+	if (this->closed) {
+		return 0;
+	}
+
+	std::streamsize done = 0;
+	while (done < n) {
+		if (pptr() == epptr()) {
+			nextBlock();
+		}
+
+		std::streamsize k = std::min<std::streamsize>(epptr() - pptr(), n - done);
+		memcpy(pptr(), src + done, k);
+		pbump(int(k));
+		done += k;
+	}
+
+	return n;
+}
+
+// blocks are only compressed once full (or at close), so there's nothing to do here
+int pgzip_ostream_buffer::sync() {
+	return 0;
+}
+
+pgzip_ostream::pgzip_ostream(const std::string& fname, const deflate_options& z, size_t blockSize) : std::ostream(&buffer), buffer(fname, z, blockSize) {
+}
+
+void pgzip_ostream::close() {
+	this->buffer.close();
+}
+
+}
+
@@ -1,22 +1,51 @@
 
 #include <obj/reader.hpp>
 #include <voxelize/image.hpp>
+#include <voxelize/incremental.hpp>
+#include <voxelize/pipeline.hpp>
+#include <voxelize/stack.hpp>
 #include <voxelize/triset.hpp>
 #include <mc/schematic.hpp>
-#include <Magick++.h>
+#include <mc/sponge.hpp>
+#include <mc/function.hpp>
+#include <mc/region.hpp>
+#include <mc/tiles.hpp>
+#include <geom/downsample.hpp>
+#include <geom/hollow.hpp>
+#include <color/cache.hpp>
+#include <color/decode.hpp>
+#include <par/pool.hpp>
+#include <par/progress.hpp>
 
-#include <sys/time.h>
-#include <time.h>
-
-void resetCounter();
-void progress(const std::string& msg, unsigned int s, unsigned int c);
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <set>
+#include <string.h>
+#include <sys/stat.h>
 
 void usage(int argc, char** argv) {
-	std::cout << "usage: " << argv[0] << " -i <input> -o <output> [-m <max-extent>]"   << std::endl
-			  << "  where"                                                             << std::endl
-			  << "    input      : The .OBJ or image file to import."                  << std::endl
-			  << "    output     : The voxelized Minecraft .schematic file to export." << std::endl
-			  << "    max-extent : The maximum number of blocks on any axis (1-256)."  << std::endl
+	std::cout << "usage: " << argv[0] << " -i <input> -o <output> [-m <max-extent>] [-l <extents>] [-f <format>] [-t <tile-size>] [-k <slice-step>] [--solid|--winding [<fill-color>]] [-c <colors>] [--hollow <thickness>] [--state <state-file>|--pipeline] [-z <level>] [-s <strategy>] [-j <threads>]" << std::endl
+			  << "       " << argv[0] << " -b <batch-file> [-J <jobs>] [<options>]" << std::endl
+			  << "  where"                                                                    << std::endl
+			  << "    input      : The .OBJ or image file (or directory of slice images) to import." << std::endl
+			  << "    output     : The voxelized Minecraft .schematic file (or region directory) to export." << std::endl
+			  << "    max-extent : The maximum number of blocks on any axis (1-256)."         << std::endl
+			  << "    extents    : Also write coarser copies at these comma-separated max extents (e.g. 32,64) -- each is downsampled from the next finer one." << std::endl
+			  << "    format     : The output format (schematic, schem2, schem3, region, mcfunction -- by default, .schem files are schem2 and .mcfunction files are mcfunction)." << std::endl
+			  << "    tile-size  : Split the output into a directory of schematics of at most this many blocks on a side." << std::endl
+			  << "    slice-step : The number of slice images to average into each layer of a slice directory." << std::endl
+			  << "    fill-color : With --solid, the inside of a (closed) mesh is filled -- with this RRGGBB color, or else the colors of its nearest surfaces." << std::endl
+			  << "                 (--winding fills meshes with holes too, but more slowly.)"   << std::endl
+			  << "    colors     : How the colors sampled in each block of a mesh are combined (average, or dominant to keep the most common one)." << std::endl
+			  << "    thickness  : Empty out everything more than this many blocks in from the outside (or any empty space)." << std::endl
+			  << "    state-file : Keep voxels here between runs, so that re-running on an edited mesh only redoes the triangles (and tiles) that changed." << std::endl
+			  << "    --pipeline : Voxelize a mesh while it's still being read (its grid then spans all of its vertices, even any that aren't in a face)." << std::endl
+			  << "    level      : The output compression level (0-9, 1 is fastest)."         << std::endl
+			  << "    strategy   : The output compression strategy (default, filtered, huffman, rle, fixed)." << std::endl
+			  << "    threads    : The number of threads to use (defaults to all processors)." << std::endl
+			  << "    batch-file : Run a job for each '<input> <output> <max-extent> [<options>]' line of this file (with the other options as defaults)." << std::endl
+			  << "    jobs       : The number of batch jobs to run at once (defaults to the number of threads)." << std::endl
 			  << std::endl;
 
 	exit(-1);
@@ -24,127 +53,534 @@ void usage(int argc, char** argv) {
 
 // read program configuration from the command-line
 struct config {
-	unsigned int maximumDimension;
-	std::string  inputObjFile;
-	std::string  outputSchematicFile;
+	unsigned int              maximumDimension;
+	std::vector<unsigned int> levels;
+	std::string               inputObjFile;
+	std::string               outputSchematicFile;
+	std::string               format;
+	unsigned int              tileSize;
+	unsigned int              sliceStep;
+	voxelize::interiorFill    fill;
+	voxelize::colorResolution colors;
+	unsigned int              hollow;
+	std::string               stateFile;
+	bool                      pipeline;
+	io::deflate_options       compression;
+	unsigned int              threads;
+	std::string               batchFile;
+	unsigned int              jobs;
 };
 
-config readConfiguration(int argc, char** argv) {
+// (bad arguments are thrown as errors, so that batch jobs can fail on their own)
+config readConfiguration(const std::vector<std::string>& args) {
 	config result;
 	result.maximumDimension = 0;
+	result.threads          = 0;
+	result.jobs             = 0;
+	result.tileSize         = 0;
+	result.sliceStep        = 1;
+	result.colors           = voxelize::averageColors;
+	result.hollow           = 0;
+	result.pipeline         = false;
 
-	for (int arg = 1; arg < argc; ++arg) {
-		std::string a = argv[arg];
-		std::string b = ((arg+1) == argc ? "" : argv[arg+1]);
+	for (size_t arg = 0; arg < args.size(); ++arg) {
+		const std::string& a = args[arg];
+		std::string        b = ((arg+1) == args.size() ? "" : args[arg+1]);
 
 		if (a == "-m" || a == "--maxEdge" || a == "--maxExtent") {
 			result.maximumDimension = str::from_string<unsigned int>(b);
 			++arg;
+		} else if (a == "-l" || a == "--levels") {
+			std::vector<std::string> es = str::csplit<char>(b, ",");
+			for (size_t i = 0; i < es.size(); ++i) {
+				unsigned int e = str::from_string<unsigned int>(str::trim<char>(es[i]));
+				if (e == 0 || e > 256) {
+					throw std::runtime_error("Invalid argument: " + a + " " + b);
+				}
+				result.levels.push_back(e);
+			}
+			++arg;
 		} else if (a == "-i" || a == "--input") {
 			result.inputObjFile = b;
 			++arg;
 		} else if (a == "-o" || a == "--output" || a == "--outputSchematic") {
 			result.outputSchematicFile = b;
 			++arg;
+		} else if (a == "-f" || a == "--format") {
+			result.format = b;
+			if (result.format != "schematic" && result.format != "schem2" && result.format != "schem3" && result.format != "region" && result.format != "mcfunction") {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "-t" || a == "--tile") {
+			result.tileSize = str::from_string<unsigned int>(b);
+			if (result.tileSize == 0) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "-k" || a == "--slice-step") {
+			result.sliceStep = str::from_string<unsigned int>(b);
+			if (result.sliceStep == 0) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "--solid" || a == "--winding") {
+			result.fill.solid   = true;
+			result.fill.winding = (a == "--winding");
+			if (!b.empty() && b[0] != '-') {
+				char* end = 0;
+				result.fill.useColor = true;
+				result.fill.color    = color::make((color::value)strtoul(b.c_str(), &end, 16));
+				if (b.size() != 6 || *end != 0) {
+					throw std::runtime_error("Invalid argument: " + a + " " + b);
+				}
+				++arg;
+			}
+		} else if (a == "-c" || a == "--colors") {
+			if (b == "average") {
+				result.colors = voxelize::averageColors;
+			} else if (b == "dominant") {
+				result.colors = voxelize::dominantColors;
+			} else {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "--hollow") {
+			result.hollow = str::from_string<unsigned int>(b);
+			if (result.hollow == 0) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "--state") {
+			result.stateFile = b;
+			++arg;
+		} else if (a == "--pipeline") {
+			result.pipeline = true;
+		} else if (a == "-z" || a == "--level") {
+			result.compression.level = str::from_string<int>(b, -2);
+			if (result.compression.level < 0 || result.compression.level > 9) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "-s" || a == "--strategy") {
+			try {
+				result.compression.strategy = io::deflateStrategy(b);
+			} catch (std::exception&) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "-b" || a == "--batch") {
+			result.batchFile = b;
+			++arg;
+		} else if (a == "-J" || a == "--jobs") {
+			result.jobs = str::from_string<unsigned int>(b);
+			if (result.jobs == 0) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
+		} else if (a == "-j" || a == "--threads") {
+			result.threads = str::from_string<unsigned int>(b);
+			if (result.threads == 0) {
+				throw std::runtime_error("Invalid argument: " + a + " " + b);
+			}
+			++arg;
 		} else {
 			std::cout << "Warning, argument ignored: " << a << std::endl;
 		}
 	}
 
-	// did we read a valid input?
-	if ((result.maximumDimension == 0 || result.maximumDimension > 256) || result.inputObjFile.empty() || result.outputSchematicFile.empty()) {
-		usage(argc, argv);
+	// the finest level is voxelized at the max extent (and the coarser ones go largest-first)
+	std::sort(result.levels.begin(), result.levels.end(), std::greater<unsigned int>());
+	result.levels.erase(std::unique(result.levels.begin(), result.levels.end()), result.levels.end());
+	if (result.maximumDimension == 0 && !result.levels.empty()) {
+		result.maximumDimension = result.levels.front();
+	}
+	while (!result.levels.empty() && result.levels.front() >= result.maximumDimension) {
+		result.levels.erase(result.levels.begin());
+	}
+
+	// did we read a valid input? (batches name theirs in the batch file)
+	if (!result.batchFile.empty()) {
+		if (!result.stateFile.empty()) {
+			throw std::runtime_error("Jobs run at once can't share a state file, so --state can only be given on each job's own line of a batch.");
+		}
+		return result;
+	} else if (result.inputObjFile.empty() || result.outputSchematicFile.empty()) {
+		throw std::runtime_error("An input and an output are required.");
+	} else if (result.maximumDimension == 0 || result.maximumDimension > 256) {
+		throw std::runtime_error("The max extent must be from 1 to 256.");
+	} else if (!result.stateFile.empty() && result.fill.solid) {
+		throw std::runtime_error("Incremental voxelization (--state) only covers surfaces, so can't be combined with --solid or --winding.");
+	} else if (!result.stateFile.empty() && result.colors != voxelize::averageColors) {
+		throw std::runtime_error("Incremental voxelization (--state) keeps color sums, so can only average colors.");
+	} else if (!result.stateFile.empty() && result.hollow > 0) {
+		throw std::runtime_error("Incremental voxelization (--state) only tracks the voxels that triangles touch, so can't be combined with --hollow.");
+	} else if (!result.stateFile.empty() && result.pipeline) {
+		throw std::runtime_error("Incremental voxelization (--state) can't be combined with --pipeline.");
+	}
+
+	// pick the output format from the file extension if it wasn't given
+	if (result.format.empty()) {
+		const std::string& o = result.outputSchematicFile;
+		if (o.size() > 6 && o.compare(o.size() - 6, 6, ".schem") == 0) {
+			result.format = "schem2";
+		} else if (o.size() > 11 && o.compare(o.size() - 11, 11, ".mcfunction") == 0) {
+			result.format = "mcfunction";
+		} else {
+			result.format = "schematic";
+		}
+	}
+
+	// (region files and functions have their own ways of splitting up the output)
+	if (result.tileSize > 0 && (result.format == "region" || result.format == "mcfunction")) {
+		throw std::runtime_error("Tiles (-t) can only be written as schematics, not in the " + result.format + " format.");
 	}
 
 	return result;
 }
 
-// perform OBJ -> MC-schematic voxelization
-int main(int argc, char** argv) {
-	config input = readConfiguration(argc, argv);
+// inputs are meshes if they're .OBJ files, slice stacks if they're directories, and images otherwise
+bool isMesh(const std::string& file) {
+	return str::lcase(str::rsplit<char>(file, ".").second) == "obj";
+}
 
-	try {
-		std::cout << "Converting mesh '" << input.inputObjFile << "' to MC-schematic '" << input.outputSchematicFile << "'.";
+bool isDirectory(const std::string& file) {
+	struct stat st;
+	return stat(file.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
 
-		Magick::InitializeMagick(argv[0]);
+// write voxels in the configured output format (only rewriting tiles where 'changed' has voxels, if it's given)
+void writeVolume(const config& input, const geom::volume& volume, const std::string& output, par::progress* prog, const geom::volume* changed = 0) {
+	if (input.tileSize > 0) {
+		mc::saveTiles(volume, output, input.tileSize, input.format, prog, input.compression, changed);
+	} else if (input.format == "schematic") {
+		mc::save(volume, output, prog, input.compression);
+	} else if (input.format == "region") {
+		mc::saveRegions(volume, output, prog, input.compression);
+	} else if (input.format == "mcfunction") {
+		mc::saveFunctions(volume, output, prog);
+	} else {
+		mc::saveSponge(volume, output, (input.format == "schem3") ? 3 : 2, prog, input.compression);
+	}
+}
 
-		// process input
-		resetCounter();
-		obj::reader in(input.inputObjFile, &progress);
+// the output file for a coarser level (e.g. 'x.schematic' at extent 32 goes to 'x.32.schematic')
+std::string levelFile(const std::string& output, unsigned int extent) {
+	std::string::size_type dot   = output.rfind('.');
+	std::string::size_type slash = output.rfind('/');
+	if (dot == std::string::npos || dot == 0 || (slash != std::string::npos && dot < slash) || isDirectory(output)) {
+		return output + "." + str::to_string(extent);
+	} else {
+		return output.substr(0, dot) + "." + str::to_string(extent) + output.substr(dot);
+	}
+}
 
-		// prepare output voxels
-		resetCounter();
-		voxelize::triset volume(input.maximumDimension, in.faces(), &progress);
+// write the coarser levels, each downsampled from the level before it
+void writeLevels(const config& input, const geom::volume& finer, size_t i, unsigned int w, unsigned int h, unsigned int d, unsigned int top, par::progress* prog) {
+	if (i == input.levels.size()) {
+		return;
+	}
 
-		// write voxels to MC file
-		resetCounter();
-		mc::save(volume, input.outputSchematicFile, &progress);
+	unsigned int e  = std::min(input.levels[i], top);
+	unsigned int lw = std::max(1u, (unsigned int)((unsigned long long)w * e / top));
+	unsigned int lh = std::max(1u, (unsigned int)((unsigned long long)h * e / top));
+	unsigned int ld = std::max(1u, (unsigned int)((unsigned long long)d * e / top));
 
-		// hooray!  we did it!
-		std::cout << std::endl << "Done." << std::endl;
-		return 0;
-	} catch (std::exception& ex) {
-		// failure is an option
-		std::cout << std::endl << ex.what() << std::endl;
-		return -1;
+	if (prog) {
+		prog->begin("Downsampling to " + str::to_string(lw) + "x" + str::to_string(lh) + "x" + str::to_string(ld));
 	}
-}
+	geom::downsample level(finer, lw, lh, ld);
+	writeVolume(input, level, levelFile(input.outputSchematicFile, input.levels[i]), prog);
 
-// print out conversion progress incrementally
-double ticks() {
-	timeval tv; memset(&tv, 0, sizeof(tv));
-	gettimeofday(&tv, 0);
-	return double(tv.tv_sec) * 1000.0 + double(tv.tv_usec) / 1000.0;
+	writeLevels(input, level, i + 1, w, h, d, top, prog);
 }
 
-double initTick = 0.0;
-void resetCounter() {
-	initTick = ticks();
-	std::cout << std::endl;
+void writeVolume(const config& input, const geom::volume& volume, par::progress* prog, const geom::volume* changed = 0) {
+	if (input.hollow > 0) {
+		// (coarser levels are downsampled from the shell, so they're hollow too)
+		config       rest = input;
+		geom::hollow shell(volume, input.hollow, prog);
+		rest.hollow = 0;
+		writeVolume(rest, shell, prog, changed);
+		return;
+	}
+
+	writeVolume(input, volume, input.outputSchematicFile, prog, changed);
+
+	unsigned int top = std::max(volume.width(), std::max(volume.height(), volume.depth()));
+	if (top > 0) {
+		writeLevels(input, volume, 0, volume.width(), volume.height(), volume.depth(), top, prog);
+	}
 }
 
-void descProgress(std::ostream& out, unsigned int s, unsigned int c) {
-	if (s == 0 || c == 0) return;
+// the time spent on each part of a conversion (in milliseconds)
+struct timing {
+	double      read;  // (reading and voxelizing the input)
+	double      write;
+	std::string state; // (how the state file changed, if there is one)
+};
 
-	double p = double(s + 1) / double(c);
-	out << " (" << 100.0 * p << "%, ";
+// perform one OBJ/image -> MC-schematic voxelization
+timing convert(const config& input, par::progress* prog) {
+	timing t;
+	double start = par::now();
+	double built = start;
 
-	double e = ticks() - initTick;
-	double r = (e / p) - e;
+	// prepare output voxels (from a mesh, or directly from an image) and write them to MC file
+	if (isMesh(input.inputObjFile) && input.pipeline) {
+		voxelize::pipeline volume(input.maximumDimension, input.inputObjFile, prog, input.fill, input.colors);
+		built = par::now();
+		writeVolume(input, volume, prog);
+	} else if (isMesh(input.inputObjFile)) {
+		obj::reader in(input.inputObjFile, prog);
 
-	static const double s1 = 1000.0;
-	static const double m1 = s1 * 60.0;
-	static const double h1 = m1 * 60.0;
-	static const double d1 = h1 * 24.0;
+		if (input.stateFile.empty()) {
+			voxelize::triset volume(input.maximumDimension, in.faces(), prog, input.fill, input.colors);
+			built = par::now();
+			writeVolume(input, volume, prog);
+		} else {
+			// (the saved state only goes with the output it was written to)
+			std::string key = input.format + " " + str::to_string(input.tileSize) + " " + input.outputSchematicFile;
 
-	if (r < s1) {
-		out << r << "ms";
-	} else if (r < m1) {
-		out << r / s1 << "s";
-	} else if (r < h1) {
-		out << r / m1 << "m";
-	} else if (r < d1) {
-		out << r / h1 << "h";
+			voxelize::incremental volume(input.maximumDimension, in.faces(), input.stateFile, key, prog);
+			t.state = std::string(volume.reused() ? "Updated" : "Started") + " '" + input.stateFile + "': " + str::to_string(volume.added()) + " triangles added, " + str::to_string(volume.removed()) + " removed.";
+			built = par::now();
+			writeVolume(input, volume, prog, &volume.changes());
+			volume.save(input.stateFile);
+		}
+	} else if (!input.stateFile.empty()) {
+		throw std::runtime_error("Incremental voxelization (--state) needs an .OBJ mesh.");
+	} else if (input.pipeline) {
+		throw std::runtime_error("Pipelined voxelization (--pipeline) needs an .OBJ mesh.");
+	} else if (isDirectory(input.inputObjFile)) {
+		voxelize::stack volume(input.maximumDimension, input.inputObjFile, input.sliceStep, prog);
+		built = par::now();
+		writeVolume(input, volume, prog);
 	} else {
-		out << r / d1 << "d";
+		voxelize::image volume(input.maximumDimension, input.inputObjFile);
+		built = par::now();
+		writeVolume(input, volume, prog);
 	}
 
-	out << " remain)";
+	t.read  = built - start;
+	t.write = par::now() - built;
+	return t;
 }
 
-void resetTerminal() {
-	std::cout << char(0x0D);
-	for (int i = 0; i < 70; ++i) {
-		std::cout << ' ';
+/*
+ * batches
+ *
+ *   each line of a batch file is a job, "<input> <output> <max-extent> [<options>]" (with
+ *   the options of the command line, which also set defaults for every job) -- jobs run
+ *   a few at a time, and share a cache of decoded textures
+ */
+static const size_t batchImageCache = size_t(512) << 20;
+
+struct job {
+	unsigned int line;
+	config       input;
+	std::string  error; // (if it couldn't be read or failed to run)
+	timing       time;
+	double       total;
+};
+typedef std::vector<job> jobs;
+
+jobs readBatch(const std::string& batchFile, const std::vector<std::string>& defaults) {
+	std::ifstream f(batchFile.c_str());
+	if (!f.is_open()) {
+		throw std::runtime_error("Unable to open the batch file '" + batchFile + "' for reading.");
 	}
-	std::cout << char(0x0D);
+
+	jobs                  result;
+	unsigned int          line = 0;
+	std::set<std::string> states; // (each job's state file must be its own)
+	while (f) {
+		std::string l;
+		std::getline(f, l);
+		++line;
+
+		l = str::trim(l);
+		if (l.empty() || l[0] == '#') continue;
+
+		std::vector<std::string> args = defaults;
+		std::vector<std::string> ws   = str::csplit<char>(l, " ");
+		std::vector<std::string> given;
+		for (size_t i = 0; i < ws.size(); ++i) {
+			if (!ws[i].empty()) {
+				given.push_back(ws[i]);
+			}
+		}
+
+		job j;
+		j.line  = line;
+		j.total = 0.0;
+		try {
+			if (given.size() < 3) {
+				throw std::runtime_error("Expected '<input> <output> <max-extent> [<options>]'.");
+			}
+
+			const char* named[] = { "-i", "-o", "-m" };
+			for (size_t i = 0; i < given.size(); ++i) {
+				if (i < 3) {
+					args.push_back(named[i]);
+				} else if (given[i] == "-b" || given[i] == "--batch" || given[i] == "-J" || given[i] == "--jobs") {
+					// (a job is one conversion, so it can't be run as a batch of its own)
+					throw std::runtime_error("'" + given[i] + "' can only be given on the command line, not for a job.");
+				}
+				args.push_back(given[i]);
+			}
+
+			j.input = readConfiguration(args);
+			if (!j.input.stateFile.empty() && !states.insert(j.input.stateFile).second) {
+				throw std::runtime_error("The state file '" + j.input.stateFile + "' is already used by another job.");
+			}
+		} catch (std::exception& ex) {
+			j.error = ex.what();
+		}
+		result.push_back(j);
+	}
+	return result;
 }
 
-void progress(const std::string& msg, unsigned int s, unsigned int c) {
-	resetTerminal();
+// run jobs, and report on each as it finishes
+struct runJobs : public par::task {
+	jobs*                  js;
+	volatile unsigned int* next;
+	volatile unsigned int* done;
+	pthread_mutex_t*       report;
+
+	void run() {
+		unsigned int i = 0;
+		while ((i = __sync_fetch_and_add(next, 1)) < js->size()) {
+			job& j = (*js)[i];
+
+			double start = par::now();
+			if (j.error.empty()) {
+				try {
+					j.time = convert(j.input, 0);
+				} catch (std::exception& ex) {
+					j.error = ex.what();
+				}
+			}
+			j.total = par::now() - start;
+
+			pthread_mutex_lock(report);
+			std::cout << "[" << __sync_add_and_fetch(done, 1) << "/" << js->size() << "] line " << j.line << ": ";
+			if (j.error.empty()) {
+				std::cout << "'" << j.input.inputObjFile << "' -> '" << j.input.outputSchematicFile << "' in " << j.total << "ms (read " << j.time.read << "ms, write " << j.time.write << "ms)" << std::endl;
+			} else {
+				std::cout << "failed, " << j.error << std::endl;
+			}
+			pthread_mutex_unlock(report);
+		}
+	}
+};
+
+// returns the number of failed jobs
+unsigned int runBatch(const config& input, const std::vector<std::string>& defaults) {
+	jobs js = readBatch(input.batchFile, defaults);
+
+	color::setImageCache(batchImageCache);
+
+	// each job thread runs one job at a time (jobs still split up their own work over the shared pool)
+	unsigned int          n    = std::max(1u, std::min<unsigned int>((input.jobs > 0) ? input.jobs : par::threads(), js.size()));
+	par::pool             p(n - 1);
+	par::group            g;
+	volatile unsigned int next = 0;
+	volatile unsigned int done = 0;
+	pthread_mutex_t       report;
+	pthread_mutex_init(&report, 0);
+
+	std::cout << "Running " << js.size() << " jobs from '" << input.batchFile << "', " << n << " at a time." << std::endl;
+
+	std::vector<runJobs> ts(n);
+	for (unsigned int i = 0; i < n; ++i) {
+		ts[i].js     = &js;
+		ts[i].next   = &next;
+		ts[i].done   = &done;
+		ts[i].report = &report;
+		if (i + 1 < n) {
+			p.push(&ts[i], g);
+		}
+	}
+	ts[n - 1].run();
+	p.wait(g);
+	pthread_mutex_destroy(&report);
+
+	unsigned int failed = 0;
+	for (jobs::const_iterator j = js.begin(); j != js.end(); ++j) {
+		failed += j->error.empty() ? 0 : 1;
+	}
+
+	std::cout << "Converted " << (js.size() - failed) << " of " << js.size() << " jobs (textures: " << color::imageCacheMisses() << " decoded, " << color::imageCacheHits() << " reused)." << std::endl;
+	return failed;
+}
+
+int main(int argc, char** argv) {
+	double startTick = par::now();
 
-	std::cout << msg;
-	descProgress(std::cout, s, c);
-	std::cout << std::flush;
+	std::vector<std::string> args(argv + 1, argv + argc);
+	config                   input;
+	try {
+		input = readConfiguration(args);
+	} catch (std::exception& ex) {
+		std::cout << ex.what() << std::endl;
+		usage(argc, argv);
+	}
+
+	try {
+		if (input.threads > 0) {
+			par::setThreads(input.threads);
+		}
+
+		// ImageMagick is only initialized if some image can't be decoded natively
+		color::deferMagickInit(argv[0]);
+		double startupTime = par::now() - startTick;
+
+		if (!input.batchFile.empty()) {
+			// batch jobs start from the command line's options (but not its batch options)
+			std::vector<std::string> defaults;
+			for (size_t i = 0; i < args.size(); ++i) {
+				if (args[i] == "-b" || args[i] == "--batch" || args[i] == "-J" || args[i] == "--jobs") {
+					++i;
+				} else {
+					defaults.push_back(args[i]);
+				}
+			}
+
+			unsigned int failed = runBatch(input, defaults);
+			std::cout << "Startup: " << startupTime << "ms, total: " << (par::now() - startTick) << "ms" << std::endl;
+			return (failed > 0) ? -1 : 0;
+		}
+
+		std::cout << "Converting '" << input.inputObjFile << "' to MC-schematic '" << input.outputSchematicFile << "'." << std::endl;
+
+		// progress is drawn as the conversion goes (unless output isn't to a terminal)
+		par::progress prog;
+		timing        t;
+		{
+			par::reporter show(prog);
+			t = convert(input, &prog);
+		}
+
+		// (said once the reporter is done drawing, so the two don't garble each other)
+		if (!t.state.empty()) {
+			std::cout << t.state << std::endl;
+		}
+
+		// hooray!  we did it!
+		std::cout << "Done." << std::endl;
+
+		std::cout << "Startup: " << startupTime << "ms";
+		if (color::magickInitTime() > 0.0) {
+			std::cout << " (+" << color::magickInitTime() << "ms deferred ImageMagick initialization)";
+		}
+		std::cout << ", total: " << (par::now() - startTick) << "ms" << std::endl;
+		return 0;
+	} catch (std::exception& ex) {
+		// failure is an option
+		std::cout << std::endl << ex.what() << std::endl;
+		return -1;
+	}
 }
 
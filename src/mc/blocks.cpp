@@ -0,0 +1,81 @@
+
+#include <mc/blocks.hpp>
+#include <vector>
+
+namespace mc {
+
+struct color_entry {
+	color_entry(color::value c, unsigned char block, unsigned char data, const char* state) : c(c), block(block), data(data), state(state) { }
+
+	color::value  c;
+	unsigned char block;
+	unsigned char data;
+	const char*   state;
+};
+typedef std::vector<color_entry> color_entries;
+
+// (air is first, so that block #'s line up with entries)
+color_entries initCE() {
+	color_entries result;
+#	define CE(rgb,block,data,state) result.push_back(color_entry(color::make(rgb), block, data, "minecraft:" state))
+	CE(0x000000, 0x00, 0x00, "air");
+	CE(0xffffff, 0x23, 0x00, "white_wool");
+	CE(0xd5712f, 0x23, 0x01, "orange_wool");
+	CE(0xb65abe, 0x23, 0x02, "magenta_wool");
+	CE(0x6586c7, 0x23, 0x03, "light_blue_wool");
+	CE(0xb3a828, 0x23, 0x04, "yellow_wool");
+	CE(0x43b63b, 0x23, 0x05, "lime_wool");
+	CE(0xd38ca0, 0x23, 0x06, "pink_wool");
+	CE(0x404040, 0x23, 0x07, "gray_wool");
+	CE(0xaaaaaa, 0x23, 0x08, "light_gray_wool");
+	CE(0x2e6f8a, 0x23, 0x09, "cyan_wool");
+	CE(0x8240ba, 0x23, 0x0a, "purple_wool");
+	CE(0x313c94, 0x23, 0x0b, "blue_wool");
+	CE(0x573722, 0x23, 0x0c, "brown_wool");
+	CE(0x36491c, 0x23, 0x0d, "green_wool");
+	CE(0xa43935, 0x23, 0x0e, "red_wool");
+	CE(0x101010, 0x23, 0x0f, "black_wool");
+#	undef CE
+	return result;
+}
+
+static color_entries color_map = initCE();
+
+unsigned int blockCount() {
+	return color_map.size();
+}
+
+block nearestBlock(color::value c) {
+	if (color::alpha(c) <= 128) {
+		// this voxel looks clear, make it air
+		return air;
+	}
+
+	block  b  = 1;
+	double md = color::distsq(c, color_map[1].c);
+
+	for (block t = 2; t < color_map.size(); ++t) {
+		double td = color::distsq(c, color_map[t].c);
+		if (td < md) {
+			md = td;
+			b  = t;
+		}
+	}
+	return b;
+}
+
+void blockID(block b, unsigned char& id, unsigned char& data) {
+	id   = color_map[b].block;
+	data = color_map[b].data;
+}
+
+const char* blockState(block b) {
+	return color_map[b].state;
+}
+
+void toMCVoxel(color::value c, unsigned char& id, unsigned char& data) {
+	blockID(nearestBlock(c), id, data);
+}
+
+}
+
@@ -0,0 +1,455 @@
+
+#include <mc/doc.hpp>
+#include <mc/pack.hpp>
+#include <mc/writer.hpp>
+#include <str/Util.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+
+namespace mc {
+
+/*
+ * arena
+ */
+static const size_t arenaAlign = 16;
+
+arena::arena(size_t chunkSize) : top(0), chunkSize(chunkSize), total(0) {
+}
+
+arena::~arena() {
+	clear();
+}
+
+void* arena::alloc(size_t n) {
+	n = (n + arenaAlign - 1) & ~(arenaAlign - 1);
+
+	if (this->top == 0 || this->top->size - this->top->used < n) {
+		// big requests get a chunk of their own
+		size_t  csz = std::max(n, this->chunkSize);
+		size_t  hsz = (sizeof(chunk) + arenaAlign - 1) & ~(arenaAlign - 1);
+		chunk*  c   = (chunk*)malloc(hsz + csz);
+		if (c == 0) {
+			throw std::runtime_error("Out of memory (allocating " + str::to_string(csz) + " bytes for an NBT document).");
+		}
+
+		c->prev = this->top;
+		c->size = csz;
+		c->used = 0;
+
+		// don't throw away the rest of the current chunk just for one big allocation
+		if (this->top != 0 && csz == n && n > this->chunkSize) {
+			c->prev         = this->top->prev;
+			this->top->prev = c;
+			c->used         = n;
+			this->total    += n;
+			return ((char*)c) + hsz;
+		}
+
+		this->top = c;
+	}
+
+	size_t hsz = (sizeof(chunk) + arenaAlign - 1) & ~(arenaAlign - 1);
+	void*  r   = ((char*)this->top) + hsz + this->top->used;
+	this->top->used += n;
+	this->total     += n;
+	return r;
+}
+
+void arena::clear() {
+	while (this->top != 0) {
+		chunk* p = this->top->prev;
+		free(this->top);
+		this->top = p;
+	}
+	this->total = 0;
+}
+
+size_t arena::size() const {
+	return this->total;
+}
+
+/*
+ * nodes
+ */
+const char* node::str() const {
+	return (const char*)this->arr.data;
+}
+
+const unsigned char* node::bytes() const {
+	return (const unsigned char*)this->arr.data;
+}
+
+const int* node::ints() const {
+	return (const int*)this->arr.data;
+}
+
+const long long* node::longs() const {
+	return (const long long*)this->arr.data;
+}
+
+unsigned int node::size() const {
+	if (this->tag == tuple::tagID() || this->tag == array::tagID()) {
+		return this->seq.size;
+	} else {
+		return this->arr.size;
+	}
+}
+
+node* node::child(const char* cname) const {
+	if (this->tag != tuple::tagID()) {
+		return 0;
+	}
+
+	for (node* c = this->seq.first; c != 0; c = c->next) {
+		if (c->name == cname || strcmp(c->name, cname) == 0) {
+			return c;
+		}
+	}
+	return 0;
+}
+
+/*
+ * documents
+ */
+document::document() : table(64, (const char*)0), nameCount(0), top(0) {
+}
+
+node* document::root() const {
+	return this->top;
+}
+
+size_t document::memory() const {
+	return this->mem.size() + this->table.size() * sizeof(const char*);
+}
+
+void document::clear() {
+	this->mem.clear();
+	this->table.assign(64, (const char*)0);
+	this->nameCount = 0;
+	this->top       = 0;
+}
+
+// intern names with FNV-1a into an open-addressed table
+inline unsigned int hashName(const char* name, size_t n) {
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < n; ++i) {
+		h = (h ^ (unsigned char)name[i]) * 16777619u;
+	}
+	return h;
+}
+
+const char* document::intern(const char* name) {
+	return intern(name, strlen(name));
+}
+
+const char* document::intern(const char* name, size_t n) {
+	size_t mask = this->table.size() - 1;
+	size_t i    = hashName(name, n) & mask;
+
+	for (; this->table[i] != 0; i = (i + 1) & mask) {
+		const char* e = this->table[i];
+		if (memcmp(e, name, n) == 0 && e[n] == 0) {
+			return e;
+		}
+	}
+
+	char* e = (char*)this->mem.alloc(n + 1);
+	memcpy(e, name, n);
+	e[n] = 0;
+
+	this->table[i] = e;
+	++this->nameCount;
+
+	// keep the table at most half full
+	if (this->nameCount * 2 > this->table.size()) {
+		names old(this->table.size() * 2, (const char*)0);
+		old.swap(this->table);
+		mask = this->table.size() - 1;
+
+		for (names::const_iterator o = old.begin(); o != old.end(); ++o) {
+			if (*o != 0) {
+				size_t j = hashName(*o, strlen(*o)) & mask;
+				while (this->table[j] != 0) {
+					j = (j + 1) & mask;
+				}
+				this->table[j] = *o;
+			}
+		}
+	}
+
+	return e;
+}
+
+void document::link(node* parent, node* n) {
+	if (parent == 0) {
+		this->top = n;
+	} else if (parent->tag == tuple::tagID() || parent->tag == array::tagID()) {
+		if (parent->tag == array::tagID() && parent->seq.etag != n->tag) {
+			throw std::runtime_error("Can't add tag #" + str::to_string(int(n->tag)) + " to a list of tag #" + str::to_string(int(parent->seq.etag)));
+		}
+
+		if (parent->seq.last) {
+			parent->seq.last->next = n;
+		} else {
+			parent->seq.first = n;
+		}
+		parent->seq.last = n;
+		++parent->seq.size;
+	} else {
+		throw std::runtime_error("Can't add a value to a tag #" + str::to_string(int(parent->tag)));
+	}
+}
+
+node* document::make(node* parent, tagid tid, const char* name) {
+	node* n = (node*)this->mem.alloc(sizeof(node));
+	memset(n, 0, sizeof(node));
+	n->tag  = tid;
+	n->name = (parent != 0 && parent->tag == array::tagID()) ? intern("", 0) : intern(name);
+	link(parent, n);
+	return n;
+}
+
+void* document::payload(node* n, size_t count, size_t width) {
+	n->arr.size = count;
+	n->arr.data = this->mem.alloc(count * width + 1);
+	return n->arr.data;
+}
+
+node* document::addTuple(node* parent, const char* name) {
+	return make(parent, tuple::tagID(), name);
+}
+
+node* document::addArray(node* parent, const char* name, tagid etag) {
+	node* n = make(parent, array::tagID(), name);
+	n->seq.etag = etag;
+	return n;
+}
+
+#define DECL_DOC_ADD(T, B, F) \
+	node* document::add(node* parent, const char* name, T x) { \
+		node* n = make(parent, B::tagID(), name); \
+		n->F = x; \
+		return n; \
+	}
+
+DECL_DOC_ADD(unsigned char, byte,   b);
+DECL_DOC_ADD(short,         int2,   s);
+DECL_DOC_ADD(int,           int4,   i);
+DECL_DOC_ADD(long,          int8,   l);
+DECL_DOC_ADD(float,         float4, f);
+DECL_DOC_ADD(double,        float8, d);
+
+node* document::add(node* parent, const char* name, const std::string& x) {
+	node* n = make(parent, string::tagID(), name);
+	char* p = (char*)payload(n, x.size(), 1);
+	memcpy(p, x.data(), x.size());
+	p[x.size()] = 0;
+	return n;
+}
+
+unsigned char* document::addBytes(node* parent, const char* name, unsigned int n) {
+	return (unsigned char*)payload(make(parent, bytes::tagID(), name), n, 1);
+}
+
+int* document::addInt4s(node* parent, const char* name, unsigned int n) {
+	return (int*)payload(make(parent, int4s::tagID(), name), n, sizeof(int));
+}
+
+long long* document::addInt8s(node* parent, const char* name, unsigned int n) {
+	return (long long*)payload(make(parent, int8s::tagID(), name), n, sizeof(long long));
+}
+
+// read :: Istream -> Document
+inline void readRaw(std::istream& in, void* dst, size_t n) {
+	if (n > 0 && !in.read((char*)dst, n)) {
+		throw std::runtime_error("Truncated NBT data.");
+	}
+}
+
+template <typename T>
+	T readBE(std::istream& in) {
+		T x = T();
+		readRaw(in, &x, sizeof(T));
+		return br(x);
+	}
+
+const char* readName(std::istream& in, document& doc, std::vector<char>& scratch) {
+	unsigned short n = (unsigned short)readBE<short>(in);
+	scratch.resize(size_t(n) + 1);
+	readRaw(in, &scratch[0], n);
+	return doc.intern(&scratch[0], n);
+}
+
+int readLength(std::istream& in) {
+	int n = readBE<int>(in);
+	if (n < 0) {
+		throw std::runtime_error("Invalid NBT array length: " + str::to_string(n));
+	}
+	return n;
+}
+
+node* document::readValue(std::istream& in, node* parent, tagid tid, const char* name, std::vector<char>& scratch) {
+	if (tid < byte::tagID() || tid > int8s::tagID()) {
+		throw std::runtime_error("Failed to decode value -- invalid tag #" + str::to_string(int(tid)));
+	}
+
+	node* n = make(parent, tid, name);
+
+	switch (tid) {
+	case 1: n->b = readBE<unsigned char>(in); break;
+	case 2: n->s = readBE<short>(in);         break;
+	case 3: n->i = readBE<int>(in);           break;
+	case 4: n->l = readBE<long>(in);          break;
+	case 5: n->f = readBE<float>(in);         break;
+	case 6: n->d = readBE<double>(in);        break;
+	case 7: {
+		int len = readLength(in);
+		readRaw(in, payload(n, len, 1), len);
+		break;
+	}
+	case 8: {
+		unsigned short len = (unsigned short)readBE<short>(in);
+		char*          p   = (char*)payload(n, len, 1);
+		readRaw(in, p, len);
+		p[len] = 0;
+		break;
+	}
+	case 9: {
+		n->seq.etag = readBE<unsigned char>(in);
+		int len = readLength(in);
+		for (int i = 0; i < len; ++i) {
+			readValue(in, n, n->seq.etag, "", scratch);
+		}
+		break;
+	}
+	case 10:
+		while (true) {
+			tagid ctid = readBE<unsigned char>(in);
+			if (ctid == 0) {
+				break;
+			}
+			readValue(in, n, ctid, readName(in, *this, scratch), scratch);
+		}
+		break;
+	case 11: {
+		int  len = readLength(in);
+		int* xs  = (int*)payload(n, len, sizeof(int));
+		readRaw(in, xs, size_t(len) * sizeof(int));
+		swap32(xs, xs, len);
+		break;
+	}
+	case 12: {
+		int        len = readLength(in);
+		long long* xs  = (long long*)payload(n, len, sizeof(long long));
+		readRaw(in, xs, size_t(len) * sizeof(long long));
+		swap64(xs, xs, len);
+		break;
+	}
+	}
+
+	return n;
+}
+
+void document::read(std::istream& in) {
+	clear();
+
+	std::vector<char> scratch;
+	tagid             tid  = readBE<unsigned char>(in);
+	const char*       name = readName(in, *this, scratch);
+	readValue(in, 0, tid, name, scratch);
+}
+
+// write :: Document -> Ostream
+void writeNode(writer& w, const node* n) {
+	switch (n->tag) {
+	case 1: w.put(n->name, n->b); break;
+	case 2: w.put(n->name, n->s); break;
+	case 3: w.put(n->name, n->i); break;
+	case 4: w.put(n->name, n->l); break;
+	case 5: w.put(n->name, n->f); break;
+	case 6: w.put(n->name, n->d); break;
+	case 7:
+		w.beginBytes(n->name, n->arr.size);
+		w.putBytes(n->bytes(), n->arr.size);
+		w.endBytes();
+		break;
+	case 8:
+		w.put(n->name, std::string(n->str(), n->arr.size));
+		break;
+	case 9:
+		w.beginArray(n->name, n->seq.etag, n->seq.size);
+		for (const node* c = n->seq.first; c != 0; c = c->next) {
+			writeNode(w, c);
+		}
+		w.endArray();
+		break;
+	case 10:
+		w.beginTuple(n->name);
+		for (const node* c = n->seq.first; c != 0; c = c->next) {
+			writeNode(w, c);
+		}
+		w.endTuple();
+		break;
+	case 11:
+		w.beginInt4s(n->name, n->arr.size);
+		w.putInt4s(n->ints(), n->arr.size);
+		w.endInt4s();
+		break;
+	case 12:
+		w.beginInt8s(n->name, n->arr.size);
+		w.putInt8s(n->longs(), n->arr.size);
+		w.endInt8s();
+		break;
+	}
+}
+
+void document::write(std::ostream& out) const {
+	if (this->top == 0) {
+		throw std::runtime_error("Can't write an empty NBT document.");
+	}
+
+	writer w(out);
+	writeNode(w, this->top);
+}
+
+// show :: Document -> Ostream
+void showNode(std::ostream& out, const node* n) {
+	if (n->name[0] != 0) {
+		out << n->name << "=";
+	}
+
+	switch (n->tag) {
+	case 1: out << "0x" << "0123456789abcdef"[n->b >> 4] << "0123456789abcdef"[n->b & 0x0f]; break;
+	case 2: out << n->s << "S";            break;
+	case 3: out << n->i;                   break;
+	case 4: out << n->l << "L";            break;
+	case 5: out << n->f << "F";            break;
+	case 6: out << n->d;                   break;
+	case 7: out << "<" << n->arr.size << "-byte array>"; break;
+	case 8: out << "\"" << n->str() << "\""; break;
+	case 11: out << "<" << n->arr.size << "-int array>"; break;
+	case 12: out << "<" << n->arr.size << "-long array>"; break;
+	case 9:
+	case 10:
+		out << ((n->tag == 9) ? "[" : "(");
+		for (const node* c = n->seq.first; c != 0; c = c->next) {
+			if (c != n->seq.first) {
+				out << ", ";
+			}
+			showNode(out, c);
+		}
+		out << ((n->tag == 9) ? "]" : ")");
+		break;
+	}
+}
+
+void document::show(std::ostream& out) const {
+	if (this->top) {
+		showNode(out, this->top);
+	}
+}
+
+}
+
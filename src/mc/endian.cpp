@@ -0,0 +1,83 @@
+
+#include <mc/endian.hpp>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSSE3__)
+#	include <tmmintrin.h>
+#elif defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+namespace mc {
+
+#if defined(__SSSE3__)
+// pshufb reverses each element's bytes in one instruction
+inline __m128i bswap32x4(__m128i x) {
+	return _mm_shuffle_epi8(x, _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3));
+}
+
+inline __m128i bswap64x2(__m128i x) {
+	return _mm_shuffle_epi8(x, _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7));
+}
+#elif defined(__SSE2__)
+// without pshufb, swap the bytes of each 16-bit word and then the words themselves
+inline __m128i bswap16x8(__m128i x) {
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+inline __m128i bswap32x4(__m128i x) {
+	x = bswap16x8(x);
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+inline __m128i bswap64x2(__m128i x) {
+	x = bswap16x8(x);
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+#endif
+
+void swap32(const void* src, void* dst, size_t n) {
+	const unsigned char* s = (const unsigned char*)src;
+	unsigned char*       d = (unsigned char*)dst;
+	size_t               i = 0;
+
+#if defined(__SSE2__)
+	for (; i + 4 <= n; i += 4) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(s + 4 * i));
+		_mm_storeu_si128((__m128i*)(d + 4 * i), bswap32x4(x));
+	}
+#endif
+
+	for (; i < n; ++i) {
+		uint32_t x;
+		memcpy(&x, s + 4 * i, 4);
+		x = __builtin_bswap32(x);
+		memcpy(d + 4 * i, &x, 4);
+	}
+}
+
+void swap64(const void* src, void* dst, size_t n) {
+	const unsigned char* s = (const unsigned char*)src;
+	unsigned char*       d = (unsigned char*)dst;
+	size_t               i = 0;
+
+#if defined(__SSE2__)
+	for (; i + 2 <= n; i += 2) {
+		__m128i x = _mm_loadu_si128((const __m128i*)(s + 8 * i));
+		_mm_storeu_si128((__m128i*)(d + 8 * i), bswap64x2(x));
+	}
+#endif
+
+	for (; i < n; ++i) {
+		uint64_t x;
+		memcpy(&x, s + 8 * i, 8);
+		x = __builtin_bswap64(x);
+		memcpy(d + 8 * i, &x, 8);
+	}
+}
+
+}
+
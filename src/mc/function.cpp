@@ -0,0 +1,194 @@
+
+#include <mc/function.hpp>
+#include <mc/blocks.hpp>
+#include <par/pool.hpp>
+#include <str/Util.hpp>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace mc {
+
+// the most blocks on each side of a box (so that none has more than the 32768 that one 'fill' can set)
+static const unsigned int maxBoxSide = 32;
+
+// a box [x0, x1] x [y0, y1] x [z0, z1] of one block
+struct box {
+	unsigned int x0, y0, z0;
+	unsigned int x1, y1, z1;
+	block        b;
+};
+typedef std::vector<box> boxes;
+
+// are the n blocks from i along x all 'b', and not in a box yet?
+inline bool runFits(const std::vector<block>& blocks, const std::vector<bool>& used, size_t i, unsigned int n, block b) {
+	for (unsigned int k = 0; k < n; ++k) {
+		if (blocks[i + k] != b || used[i + k]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// merge the blocks of each y slab into boxes (no box crosses slabs, since they're as high as boxes can be)
+struct mergeSlabs {
+	const geom::volume* v;
+	std::vector<boxes>* out;
+	par::progress*      prog;
+
+	void operator()(unsigned int s) {
+		unsigned int w  = v->width();
+		unsigned int d  = v->depth();
+		unsigned int y0 = s * maxBoxSide;
+		unsigned int h  = std::min(v->height() - y0, maxBoxSide);
+
+		// blocks[(y * d + z) * w + x] (with y relative to the slab), and which are already in a box
+		std::vector<block>        blocks(size_t(w) * d * h);
+		std::vector<bool>         used(blocks.size(), false);
+		std::vector<color::value> row(w);
+
+		for (unsigned int y = 0; y < h; ++y) {
+			for (unsigned int z = 0; z < d; ++z) {
+				v->readRow(0, y0 + y, z, w, &row[0]);
+				block* bs = &blocks[(size_t(y) * d + z) * w];
+				for (unsigned int x = 0; x < w; ++x) {
+					bs[x] = nearestBlock(row[x]);
+				}
+			}
+		}
+
+		boxes& r = (*out)[s];
+		for (unsigned int y = 0; y < h; ++y) {
+			for (unsigned int z = 0; z < d; ++z) {
+				for (unsigned int x = 0; x < w; ++x) {
+					size_t i = (size_t(y) * d + z) * w + x;
+					block  b = blocks[i];
+					if (b == air || used[i]) {
+						continue;
+					}
+
+					// as far along x as this block runs, then as many z rows and y layers as match that
+					unsigned int bw = 1, bd = 1, bh = 1;
+					while (x + bw < w && bw < maxBoxSide && runFits(blocks, used, i + bw, 1, b)) {
+						++bw;
+					}
+					while (z + bd < d && bd < maxBoxSide && runFits(blocks, used, i + size_t(bd) * w, bw, b)) {
+						++bd;
+					}
+					for (bool grow = true; grow && y + bh < h; ) {
+						size_t j = i + size_t(bh) * d * w;
+						for (unsigned int k = 0; grow && k < bd; ++k) {
+							grow = runFits(blocks, used, j + size_t(k) * w, bw, b);
+						}
+						if (grow) {
+							++bh;
+						}
+					}
+
+					for (unsigned int by = y; by < y + bh; ++by) {
+						for (unsigned int bz = z; bz < z + bd; ++bz) {
+							size_t j = (size_t(by) * d + bz) * w + x;
+							for (unsigned int bx = 0; bx < bw; ++bx) {
+								used[j + bx] = true;
+							}
+						}
+					}
+
+					box bx;
+					bx.x0 = x;      bx.x1 = x + bw - 1;
+					bx.y0 = y0 + y; bx.y1 = y0 + y + bh - 1;
+					bx.z0 = z;      bx.z1 = z + bd - 1;
+					bx.b  = b;
+					r.push_back(bx);
+				}
+			}
+		}
+
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+};
+
+// one box's command (single blocks are just set)
+inline void putCommand(std::ostream& out, const box& b) {
+	if (b.x0 == b.x1 && b.y0 == b.y1 && b.z0 == b.z1) {
+		out << "setblock ~" << b.x0 << " ~" << b.y0 << " ~" << b.z0 << " " << blockState(b.b) << "\n";
+	} else {
+		out << "fill ~" << b.x0 << " ~" << b.y0 << " ~" << b.z0 << " ~" << b.x1 << " ~" << b.y1 << " ~" << b.z1 << " " << blockState(b.b) << "\n";
+	}
+}
+
+// the file for part i (of n)
+inline std::string partFile(const std::string& filename, unsigned int i, unsigned int n) {
+	if (n == 1) {
+		return filename;
+	}
+
+	std::string ext  = ".mcfunction";
+	bool        hasX = filename.size() > ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+	std::string base = hasX ? filename.substr(0, filename.size() - ext.size()) : filename;
+	return base + "_" + str::to_string(i) + ext;
+}
+
+void saveFunctions(const geom::volume& v, const std::string& filename, par::progress* prog, unsigned int maxCommands) {
+	if (maxCommands == 0) {
+		throw std::runtime_error("Functions must hold at least one command.");
+	}
+
+	// merge boxes a slab at a time
+	unsigned int       slabs = (v.height() + maxBoxSide - 1) / maxBoxSide;
+	std::vector<boxes> bs(slabs);
+
+	if (prog) {
+		prog->begin("Merging blocks", slabs);
+	}
+	mergeSlabs f;
+	f.v    = &v;
+	f.out  = &bs;
+	f.prog = prog;
+	par::each(slabs, f);
+
+	// then write their commands (in slab order), as many to a file as will run at once
+	size_t n = 0;
+	for (unsigned int s = 0; s < slabs; ++s) {
+		n += bs[s].size();
+	}
+	unsigned int files = std::max(size_t(1), (n + maxCommands - 1) / maxCommands);
+
+	if (prog) {
+		prog->begin("Writing commands", n);
+	}
+
+	unsigned int s = 0;
+	size_t       i = 0;
+	for (unsigned int p = 0; p < files; ++p) {
+		std::string   file = partFile(filename, p, files);
+		std::ofstream out(file.c_str());
+		if (!out) {
+			throw std::runtime_error("Unable to open the function file '" + file + "' for writing.");
+		}
+
+		for (unsigned int c = 0; c < maxCommands; ++c) {
+			while (s < slabs && i == bs[s].size()) {
+				++s;
+				i = 0;
+			}
+			if (s == slabs) {
+				break;
+			}
+
+			putCommand(out, bs[s][i++]);
+			if (prog) {
+				prog->add();
+			}
+		}
+
+		if (!out) {
+			throw std::runtime_error("Failed to write the function file '" + file + "'.");
+		}
+	}
+}
+
+}
@@ -0,0 +1,414 @@
+
+#include <mc/index.hpp>
+#include <mc/pack.hpp>
+#include <str/Util.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+namespace mc {
+
+/*
+ * blob
+ */
+blob::blob(const std::string& filename) : bytes(0), n(0), isMapped(false) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Unable to open the NBT file '" + filename + "' for reading.");
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		throw std::runtime_error("Unable to read the NBT file '" + filename + "'.");
+	}
+
+	size_t fsz = st.st_size;
+	void*  m   = mmap(0, fsz, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (m == MAP_FAILED) {
+		throw std::runtime_error("Unable to map the NBT file '" + filename + "' into memory.");
+	}
+
+	const unsigned char* src = (const unsigned char*)m;
+	if (fsz < 18 || src[0] != 0x1f || src[1] != 0x8b) {
+		// plain NBT, just use the mapping
+		this->bytes    = (unsigned char*)m;
+		this->n        = fsz;
+		this->isMapped = true;
+		return;
+	}
+
+	// gzipped NBT, inflate it all at once (the trailer gives the size, mod 4G)
+	size_t isize = size_t(src[fsz - 4]) | (size_t(src[fsz - 3]) << 8) | (size_t(src[fsz - 2]) << 16) | (size_t(src[fsz - 1]) << 24);
+	size_t cap   = std::max(isize, fsz * 4);
+
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+		munmap(m, fsz);
+		throw std::runtime_error("Failed to initialize zlib to read '" + filename + "'.");
+	}
+
+	zs.next_in  = (Bytef*)src;
+	zs.avail_in = fsz;
+
+	unsigned char* out  = (unsigned char*)malloc(cap);
+	size_t         done = 0;
+	int            zr   = Z_OK;
+	while (out != 0) {
+		zs.next_out  = out + done;
+		zs.avail_out = (uInt)std::min(cap - done, size_t(1 << 30));
+
+		zr   = inflate(&zs, Z_NO_FLUSH);
+		done = zs.next_out - out;
+
+		if (zr == Z_STREAM_END) {
+			// concatenated gzip members just continue the stream
+			if (zs.avail_in >= 2 && zs.next_in[0] == 0x1f && zs.next_in[1] == 0x8b) {
+				inflateReset(&zs);
+				continue;
+			}
+			break;
+		} else if (zr != Z_OK) {
+			break;
+		}
+
+		if (done == cap) {
+			cap *= 2;
+			unsigned char* grown = (unsigned char*)realloc(out, cap);
+			if (grown == 0) {
+				free(out);
+			}
+			out = grown;
+		}
+	}
+
+	this->n = done;
+	inflateEnd(&zs);
+	munmap(m, fsz);
+
+	if (out == 0) {
+		throw std::runtime_error("Out of memory inflating '" + filename + "'.");
+	} else if (zr != Z_STREAM_END) {
+		free(out);
+		throw std::runtime_error("Failed to inflate the NBT file '" + filename + "'.");
+	}
+
+	this->bytes = out;
+}
+
+blob::~blob() {
+	if (this->isMapped) {
+		munmap(this->bytes, this->n);
+	} else {
+		free(this->bytes);
+	}
+}
+
+const unsigned char* blob::data() const {
+	return this->bytes;
+}
+
+size_t blob::size() const {
+	return this->n;
+}
+
+bool blob::mapped() const {
+	return this->isMapped;
+}
+
+/*
+ * decoding helpers
+ */
+template <typename T>
+	T decodeBE(const unsigned char* p) {
+		T x;
+		memcpy(&x, p, sizeof(T));
+		return br(x);
+	}
+
+inline size_t widthOf(tagid tid) {
+	switch (tid) {
+	case 1:  return 1;
+	case 2:  return 2;
+	case 3:  return 4;
+	case 4:  return 8;
+	case 5:  return 4;
+	case 6:  return 8;
+	default: return 0;
+	}
+}
+
+/*
+ * index
+ */
+index::index(const std::string& filename) : bytes(filename) {
+}
+
+const blob& index::file() const {
+	return this->bytes;
+}
+
+// bounds-checked access to file data
+const unsigned char* index::at(size_t p, size_t k) const {
+	if (p > this->bytes.size() || k > this->bytes.size() - p) {
+		throw std::runtime_error("Truncated NBT data (at offset " + str::to_string(p) + ").");
+	}
+	return this->bytes.data() + p;
+}
+
+entry index::root() const {
+	tagid  tid = *at(0, 1);
+	size_t nl  = (unsigned short)decodeBE<short>(at(1, 2));
+	at(3, nl);
+	return entry(this, tid, 1, 3 + nl);
+}
+
+// find the end of the payload of a value of type 'tid' starting at 'p'
+size_t index::skip(tagid tid, size_t p) const {
+	size_t w = widthOf(tid);
+	if (w > 0) {
+		at(p, w);
+		return p + w;
+	}
+
+	switch (tid) {
+	case 7:  return p + 4 + size_t((unsigned int)decodeBE<int>(at(p, 4)));
+	case 8:  return p + 2 + size_t((unsigned short)decodeBE<short>(at(p, 2)));
+	case 11: return p + 4 + 4 * size_t((unsigned int)decodeBE<int>(at(p, 4)));
+	case 12: return p + 4 + 8 * size_t((unsigned int)decodeBE<int>(at(p, 4)));
+	case 9:
+	case 10: {
+		endIndex::const_iterator e = this->ends.find(p);
+		if (e != this->ends.end()) {
+			return e->second;
+		}
+
+		size_t end = 0;
+		if (tid == 9) {
+			tagid  etag = *at(p, 1);
+			int    len  = decodeBE<int>(at(p + 1, 4));
+			size_t ew   = widthOf(etag);
+
+			if (ew > 0) {
+				end = p + 5 + ew * size_t(len > 0 ? len : 0);
+				at(p + 5, end - (p + 5));
+			} else {
+				end = p + 5;
+				for (int i = 0; i < len; ++i) {
+					end = skip(etag, end);
+				}
+			}
+		} else {
+			end = p;
+			while (true) {
+				tagid ctid = *at(end, 1);
+				if (ctid == 0) {
+					++end;
+					break;
+				}
+
+				size_t nl = (unsigned short)decodeBE<short>(at(end + 1, 2));
+				end = skip(ctid, end + 3 + nl);
+			}
+		}
+
+		this->ends[p] = end;
+		return end;
+	}
+	default:
+		throw std::runtime_error("Failed to decode value -- invalid tag #" + str::to_string(int(tid)));
+	}
+}
+
+const index::children& index::childrenOf(tagid tid, size_t p) const {
+	childIndex::const_iterator k = this->kids.find(p);
+	if (k != this->kids.end()) {
+		return k->second;
+	}
+
+	children cs;
+	size_t   end = 0;
+	if (tid == 9) {
+		tagid etag = *at(p, 1);
+		int   len  = decodeBE<int>(at(p + 1, 4));
+
+		end = p + 5;
+		cs.reserve(len > 0 ? len : 0);
+		for (int i = 0; i < len; ++i) {
+			child c;
+			c.tid    = etag;
+			c.nameAt = 0;
+			c.at     = end;
+			cs.push_back(c);
+			end = skip(etag, end);
+		}
+	} else {
+		end = p;
+		while (true) {
+			tagid ctid = *at(end, 1);
+			if (ctid == 0) {
+				++end;
+				break;
+			}
+
+			child c;
+			c.tid    = ctid;
+			c.nameAt = end + 1;
+			c.at     = end + 3 + (unsigned short)decodeBE<short>(at(end + 1, 2));
+			cs.push_back(c);
+			end = skip(ctid, c.at);
+		}
+	}
+
+	this->ends[p] = end;
+	children& r = this->kids[p];
+	r.swap(cs);
+	return r;
+}
+
+/*
+ * entry
+ */
+entry::entry() : idx(0), tid(0), nameAt(0), at(0) {
+}
+
+entry::entry(const index* idx, tagid tid, size_t nameAt, size_t at) : idx(idx), tid(tid), nameAt(nameAt), at(at) {
+}
+
+bool entry::valid() const {
+	return this->idx != 0;
+}
+
+tagid entry::tag() const {
+	return this->tid;
+}
+
+void entry::expect(tagid t) const {
+	if (this->idx == 0) {
+		throw std::runtime_error("Can't read an invalid NBT entry.");
+	} else if (this->tid != t) {
+		throw std::runtime_error("Expected NBT tag #" + str::to_string(int(t)) + " but found tag #" + str::to_string(int(this->tid)));
+	}
+}
+
+std::string entry::name() const {
+	if (this->idx == 0 || this->nameAt == 0) {
+		return "";
+	}
+
+	size_t nl = (unsigned short)decodeBE<short>(this->idx->at(this->nameAt, 2));
+	return std::string((const char*)this->idx->at(this->nameAt + 2, nl), nl);
+}
+
+#define DECL_ENTRY_GET(T, F, B) \
+	T entry::F() const { \
+		expect(B::tagID()); \
+		return decodeBE<T>(this->idx->at(this->at, sizeof(T))); \
+	}
+
+DECL_ENTRY_GET(unsigned char, asByte,   byte);
+DECL_ENTRY_GET(short,         asInt2,   int2);
+DECL_ENTRY_GET(int,           asInt4,   int4);
+DECL_ENTRY_GET(long,          asInt8,   int8);
+DECL_ENTRY_GET(float,         asFloat4, float4);
+DECL_ENTRY_GET(double,        asFloat8, float8);
+
+std::string entry::asString() const {
+	expect(string::tagID());
+	size_t nl = (unsigned short)decodeBE<short>(this->idx->at(this->at, 2));
+	return std::string((const char*)this->idx->at(this->at + 2, nl), nl);
+}
+
+unsigned int entry::size() const {
+	if (this->idx == 0 || (this->tid != bytes::tagID() && this->tid != int4s::tagID() && this->tid != int8s::tagID())) {
+		throw std::runtime_error("NBT entry is not an array payload.");
+	}
+	return (unsigned int)decodeBE<int>(this->idx->at(this->at, 4));
+}
+
+const unsigned char* entry::raw() const {
+	unsigned int n = size();
+	size_t       w = (this->tid == bytes::tagID()) ? 1 : (this->tid == int4s::tagID()) ? 4 : 8;
+	return this->idx->at(this->at + 4, w * n);
+}
+
+int entry::int4At(unsigned int i) const {
+	expect(int4s::tagID());
+	if (i >= size()) {
+		throw std::runtime_error("NBT int array index out of bounds.");
+	}
+	return decodeBE<int>(this->idx->at(this->at + 4 + 4 * size_t(i), 4));
+}
+
+long long entry::int8At(unsigned int i) const {
+	expect(int8s::tagID());
+	if (i >= size()) {
+		throw std::runtime_error("NBT long array index out of bounds.");
+	}
+	return decodeBE<long long>(this->idx->at(this->at + 4 + 8 * size_t(i), 8));
+}
+
+void entry::decode(std::vector<int>& out) const {
+	expect(int4s::tagID());
+	const unsigned char* p = raw();
+	out.resize(size());
+	if (!out.empty()) {
+		swap32(p, &out[0], out.size());
+	}
+}
+
+void entry::decode(std::vector<long long>& out) const {
+	expect(int8s::tagID());
+	const unsigned char* p = raw();
+	out.resize(size());
+	if (!out.empty()) {
+		swap64(p, &out[0], out.size());
+	}
+}
+
+unsigned int entry::count() const {
+	if (this->idx == 0 || (this->tid != tuple::tagID() && this->tid != array::tagID())) {
+		return 0;
+	}
+	return this->idx->childrenOf(this->tid, this->at).size();
+}
+
+entry entry::child(unsigned int i) const {
+	if (i >= count()) {
+		throw std::runtime_error("NBT child index out of bounds.");
+	}
+
+	const index::child& c = this->idx->childrenOf(this->tid, this->at)[i];
+	return entry(this->idx, c.tid, c.nameAt, c.at);
+}
+
+entry entry::child(const std::string& cname) const {
+	if (this->idx == 0 || this->tid != tuple::tagID()) {
+		return entry();
+	}
+
+	const index::children& cs = this->idx->childrenOf(this->tid, this->at);
+	for (index::children::const_iterator c = cs.begin(); c != cs.end(); ++c) {
+		size_t nl = (unsigned short)decodeBE<short>(this->idx->at(c->nameAt, 2));
+		if (nl == cname.size() && memcmp(this->idx->at(c->nameAt + 2, nl), cname.data(), nl) == 0) {
+			return entry(this->idx, c->tid, c->nameAt, c->at);
+		}
+	}
+	return entry();
+}
+
+tagid entry::elementTag() const {
+	expect(array::tagID());
+	return *this->idx->at(this->at, 1);
+}
+
+}
+
@@ -0,0 +1,282 @@
+
+#include <mc/region.hpp>
+#include <mc/blocks.hpp>
+#include <mc/value.hpp>
+#include <mc/writer.hpp>
+#include <par/pool.hpp>
+#include <str/Util.hpp>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+namespace mc {
+
+// chunks are written for 1.20.1, below which the world has four more (empty) sections
+static const int regionDataVersion = 3465;
+static const int minSectionY       = -4;
+
+static const unsigned int chunksPerRegion = 32;
+static const unsigned int sectorSize      = 4096;
+static const unsigned int maxSectors      = 255;
+
+// the encoded (and compressed) form of one chunk column
+struct chunk {
+	int                        cx;
+	int                        cz;
+	std::vector<unsigned char> data;
+	unsigned int               sector;
+	unsigned int               sectors;
+};
+typedef std::vector<chunk> chunks;
+
+// write one 16x16x16 section of blocks, with its palette and (if more than one block occurs) packed indexes
+void writeSection(writer& w, const std::vector<block>& bs, int y) {
+	std::vector<int>   paletteIndex(blockCount(), -1);
+	std::vector<block> palette;
+	std::vector<int>   idxs(bs.size());
+
+	for (unsigned int i = 0; i < bs.size(); ++i) {
+		if (paletteIndex[bs[i]] < 0) {
+			paletteIndex[bs[i]] = int(palette.size());
+			palette.push_back(bs[i]);
+		}
+		idxs[i] = paletteIndex[bs[i]];
+	}
+
+	w.beginTuple("");
+	w.put("Y", (unsigned char)(y));
+
+	w.beginTuple("block_states");
+	w.beginArray("palette", tuple::tagID(), int(palette.size()));
+	for (unsigned int i = 0; i < palette.size(); ++i) {
+		w.beginTuple("");
+		w.put("Name", std::string(blockState(palette[i])));
+		w.endTuple();
+	}
+	w.endArray();
+
+	if (palette.size() > 1) {
+		// at least 4 bits per index, and indexes don't span longs
+		unsigned int bits = 4;
+		while ((1u << bits) < palette.size()) {
+			++bits;
+		}
+		unsigned int           per = 64 / bits;
+		std::vector<long long> packed((idxs.size() + per - 1) / per, 0);
+
+		for (unsigned int i = 0; i < idxs.size(); ++i) {
+			packed[i / per] |= (long long)((unsigned long long)idxs[i] << (bits * (i % per)));
+		}
+
+		w.beginInt8s("data", int(packed.size()));
+		w.putInt8s(&packed[0], packed.size());
+		w.endInt8s();
+	}
+	w.endTuple();
+
+	w.beginTuple("biomes");
+	w.beginArray("palette", string::tagID(), 1);
+	w.put("", std::string("minecraft:plains"));
+	w.endArray();
+	w.endTuple();
+
+	w.endTuple();
+}
+
+// encode and compress chunk columns (volume voxels are read concurrently)
+struct encodeChunks {
+	const geom::volume* v;
+	chunks*             cs;
+	io::deflate_options z;
+
+	void operator()(unsigned int i) {
+		chunk& c = (*cs)[i];
+
+		unsigned int ns = (v->height() + 15) / 16;
+		unsigned int x0 = 16 * c.cx;
+		unsigned int z0 = 16 * c.cz;
+		unsigned int nx = std::min(16u, v->width() - x0);
+		unsigned int nz = std::min(16u, v->depth() - z0);
+
+		std::vector<block>        bs(16 * 16 * 16);
+		std::vector<color::value> row(16);
+
+		std::ostringstream ss;
+		writer w(ss);
+
+		w.beginTuple("");
+		w.put("DataVersion",   regionDataVersion);
+		w.put("xPos",          c.cx);
+		w.put("zPos",          c.cz);
+		w.put("yPos",          minSectionY);
+		w.put("Status",        std::string("minecraft:full"));
+		w.put("LastUpdate",    long(0));
+		w.put("InhabitedTime", long(0));
+		w.put("isLightOn",     (unsigned char)0);
+
+		w.beginArray("sections", tuple::tagID(), int(ns));
+		for (unsigned int s = 0; s < ns; ++s) {
+			std::fill(bs.begin(), bs.end(), air);
+
+			for (unsigned int y = 0; y < 16 && 16 * s + y < v->height(); ++y) {
+				for (unsigned int z = 0; z < nz; ++z) {
+					v->readRow(x0, 16 * s + y, z0 + z, nx, &row[0]);
+					for (unsigned int x = 0; x < nx; ++x) {
+						bs[(y * 16 + z) * 16 + x] = nearestBlock(row[x]);
+					}
+				}
+			}
+			writeSection(w, bs, int(s));
+		}
+		w.endArray();
+
+		w.beginArray("block_entities", tuple::tagID(), 0);
+		w.endArray();
+		w.endTuple();
+
+		// chunks are stored zlib-compressed, behind their length and compression type
+		std::string raw = ss.str();
+
+		z_stream zs;
+		memset(&zs, 0, sizeof(zs));
+		if (deflateInit2(&zs, this->z.level, Z_DEFLATED, 15, 8, this->z.strategy) != Z_OK) {
+			throw std::runtime_error("Unable to initialize chunk compression.");
+		}
+
+		c.data.resize(5 + deflateBound(&zs, raw.size()));
+		zs.next_in   = (Bytef*)raw.data();
+		zs.avail_in  = raw.size();
+		zs.next_out  = &c.data[5];
+		zs.avail_out = c.data.size() - 5;
+
+		int r = deflate(&zs, Z_FINISH);
+		size_t n = zs.total_out;
+		deflateEnd(&zs);
+		if (r != Z_STREAM_END) {
+			throw std::runtime_error("Failed to compress chunk (" + str::to_string(c.cx) + ", " + str::to_string(c.cz) + ")");
+		}
+
+		c.data.resize(5 + n);
+		unsigned int len = n + 1;
+		c.data[0] = (unsigned char)(len >> 24);
+		c.data[1] = (unsigned char)(len >> 16);
+		c.data[2] = (unsigned char)(len >>  8);
+		c.data[3] = (unsigned char)(len);
+		c.data[4] = 2; // zlib
+
+		c.sectors = (c.data.size() + sectorSize - 1) / sectorSize;
+		if (c.sectors > maxSectors) {
+			throw std::runtime_error("Chunk (" + str::to_string(c.cx) + ", " + str::to_string(c.cz) + ") is too large for a region file.");
+		}
+	}
+};
+
+// write encoded chunks into their sectors
+struct writeChunks {
+	int           fd;
+	const chunks* cs;
+
+	void operator()(unsigned int i) {
+		const chunk& c = (*cs)[i];
+		if (pwrite(this->fd, &c.data[0], c.data.size(), off_t(c.sector) * sectorSize) != ssize_t(c.data.size())) {
+			throw std::runtime_error("Failed to write chunk (" + str::to_string(c.cx) + ", " + str::to_string(c.cz) + ") to its region file.");
+		}
+	}
+};
+
+void saveRegion(const geom::volume& v, const std::string& filename, int rx, int rz, const io::deflate_options& z) {
+	unsigned int ncx = (v.width() + 15) / 16;
+	unsigned int ncz = (v.depth() + 15) / 16;
+
+	// the chunks of this region that the volume covers
+	chunks cs;
+	for (unsigned int cz = rz * chunksPerRegion; cz < ncz && cz < (rz + 1) * chunksPerRegion; ++cz) {
+		for (unsigned int cx = rx * chunksPerRegion; cx < ncx && cx < (rx + 1) * chunksPerRegion; ++cx) {
+			chunk c;
+			c.cx      = int(cx);
+			c.cz      = int(cz);
+			c.sector  = 0;
+			c.sectors = 0;
+			cs.push_back(c);
+		}
+	}
+
+	encodeChunks ef;
+	ef.v  = &v;
+	ef.cs = &cs;
+	ef.z  = z;
+	par::each(cs.size(), ef);
+
+	// lay chunks out after the two header sectors (locations and timestamps)
+	std::vector<unsigned char> header(2 * sectorSize, 0);
+	unsigned int sector = 2;
+	for (unsigned int i = 0; i < cs.size(); ++i) {
+		chunk&       c = cs[i];
+		unsigned int h = 4 * ((c.cx % chunksPerRegion) + (c.cz % chunksPerRegion) * chunksPerRegion);
+
+		c.sector      = sector;
+		header[h + 0] = (unsigned char)(sector >> 16);
+		header[h + 1] = (unsigned char)(sector >>  8);
+		header[h + 2] = (unsigned char)(sector);
+		header[h + 3] = (unsigned char)(c.sectors);
+		sector += c.sectors;
+	}
+
+	int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw std::runtime_error("Unable to open the region file '" + filename + "' for writing.");
+	}
+
+	try {
+		if (pwrite(fd, &header[0], header.size(), 0) != ssize_t(header.size())) {
+			throw std::runtime_error("Failed to write the header of the region file '" + filename + "'.");
+		}
+
+		writeChunks wf;
+		wf.fd = fd;
+		wf.cs = &cs;
+		par::each(cs.size(), wf);
+
+		// the file is padded out to a whole number of sectors
+		if (ftruncate(fd, off_t(sector) * sectorSize) != 0) {
+			throw std::runtime_error("Failed to pad the region file '" + filename + "'.");
+		}
+	} catch (...) {
+		close(fd);
+		throw;
+	}
+
+	if (close(fd) != 0) {
+		throw std::runtime_error("Failed to finish writing the region file '" + filename + "'.");
+	}
+}
+
+void saveRegions(const geom::volume& v, const std::string& directory, par::progress* prog, const io::deflate_options& z) {
+	unsigned int nrx = (v.width() + 16 * chunksPerRegion - 1) / (16 * chunksPerRegion);
+	unsigned int nrz = (v.depth() + 16 * chunksPerRegion - 1) / (16 * chunksPerRegion);
+
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		throw std::runtime_error("Unable to create the region directory '" + directory + "'.");
+	}
+
+	if (prog) {
+		prog->begin("Writing regions", nrx * nrz);
+	}
+	for (unsigned int rz = 0; rz < nrz; ++rz) {
+		for (unsigned int rx = 0; rx < nrx; ++rx) {
+			saveRegion(v, directory + "/r." + str::to_string(rx) + "." + str::to_string(rz) + ".mca", int(rx), int(rz), z);
+			if (prog) {
+				prog->add();
+			}
+		}
+	}
+}
+
+}
+
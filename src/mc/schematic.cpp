@@ -1,118 +1,96 @@
 
 #include <mc/schematic.hpp>
+#include <mc/blocks.hpp>
+#include <mc/spool.hpp>
 #include <mc/value.hpp>
-#include <io/gzip_stream.hpp>
+#include <mc/writer.hpp>
+#include <io/pgzip_stream.hpp>
+#include <par/pool.hpp>
+#include <algorithm>
 
 namespace mc {
 
-struct color_entry {
-	color_entry(color::value c, unsigned char block, unsigned char data) : c(c), block(block), data(data) { }
-
-	color::value  c;
-	unsigned char block;
-	unsigned char data;
-};
-typedef std::vector<color_entry> color_entries;
-
-color_entries initCE() {
-	color_entries result;
-#	define CE(rgb,block,data) result.push_back(color_entry(color::make(rgb), block, data))
-	CE(0xffffff, 0x23, 0x00);
-	CE(0xd5712f, 0x23, 0x01);
-	CE(0xb65abe, 0x23, 0x02);
-	CE(0x6586c7, 0x23, 0x03);
-	CE(0xb3a828, 0x23, 0x04);
-	CE(0x43b63b, 0x23, 0x05);
-	CE(0xd38ca0, 0x23, 0x06);
-	CE(0x404040, 0x23, 0x07);
-	CE(0xaaaaaa, 0x23, 0x08);
-	CE(0x2e6f8a, 0x23, 0x09);
-	CE(0x8240ba, 0x23, 0x0a);
-	CE(0x313c94, 0x23, 0x0b);
-	CE(0x573722, 0x23, 0x0c);
-	CE(0x36491c, 0x23, 0x0d);
-	CE(0xa43935, 0x23, 0x0e);
-	CE(0x101010, 0x23, 0x0f);
-	return result;
-}
-
-static color_entries color_map = initCE();
-
-void toMCVoxel(color::value c, unsigned char& block, unsigned char& data) {
-	if (color::alpha(c) <= 128) {
-		// this voxel looks clear, make it air
-		block = 0;
-		data  = 0;
-	} else {
-		unsigned int i  = 0;
-		double       md = color::distsq(c, color_map[0].c);
-
-		for (unsigned int t = 1; t < color_map.size(); ++t) {
-			double td = color::distsq(c, color_map[t].c);
-			if (td < md) {
-				md = td;
-				i  = t;
+// convert y slabs of a volume to block IDs and data values, slab i (of a batch from y0) at offset i * width * depth
+struct convertSlabs {
+	const geom::volume* v;
+	unsigned int        y0;
+	unsigned char*      blocks;
+	unsigned char*      datas;
+
+	void operator()(unsigned int i) {
+		unsigned int cx = v->width();
+		unsigned int cz = v->depth();
+		size_t       o  = size_t(i) * cx * cz;
+
+		std::vector<color::value> row(cx);
+		for (unsigned int z = 0; z < cz; ++z, o += cx) {
+			v->readRow(0, this->y0 + i, z, cx, &row[0]);
+			for (unsigned int x = 0; x < cx; ++x) {
+				toMCVoxel(row[x], this->blocks[o + x], this->datas[o + x]);
 			}
 		}
-
-		block = color_map[i].block;
-		data  = color_map[i].data;
 	}
-}
+};
 
-void save(const geom::volume& v, const std::string& filename, PROGRESSFN pfn) {
+void save(const geom::volume& v, const std::string& filename, par::progress* prog, const io::deflate_options& z) {
 	unsigned int cx = v.width();
 	unsigned int cy = v.height();
 	unsigned int cz = v.depth();
 
 	// try to open the compressed output stream
-	io::gzip_ostream<char> out(filename);
-
-	// make the MC value to wrap this data
-	tuple* x = new tuple("Schematic");
-	x->unbox().push_back(new int2("Width",  short(cx)));
-	x->unbox().push_back(new int2("Length", short(cz)));
-	x->unbox().push_back(new int2("Height", short(cy)));
-	x->unbox().push_back(new string("Materials", "Alpha"));
-
-	bytes* blocks       = new bytes("Blocks");
-	bytes* datas        = new bytes("Data");
-	array* entities     = new array("Entities", hvalues(tuple::tagID(), values()));
-	array* tileEntities = new array("TileEntities", hvalues(tuple::tagID(), values()));
-
-	x->unbox().push_back(blocks);
-	x->unbox().push_back(datas);
-	x->unbox().push_back(entities);
-	x->unbox().push_back(tileEntities);
-
-	// voxelize the input volume
+	io::pgzip_ostream out(filename, z);
+	writer w(out);
+
+	w.beginTuple("Schematic");
+	w.put("Width",  short(cx));
+	w.put("Length", short(cz));
+	w.put("Height", short(cy));
+	w.put("Materials", std::string("Alpha"));
+
+	// voxelize the input volume a batch of y slabs at a time (the slabs of a
+	// batch are converted concurrently) -- block IDs go straight out, data
+	// values are spooled until the block array is finished
 	typedef std::vector<unsigned char> BVec;
-	BVec& blocksv = blocks->unbox();
-	BVec& datasv  = datas->unbox();
-	
-	blocksv.reserve(cx * cy * cz);
-	datasv.reserve(cx * cy * cz);
-
-	for (unsigned int y = 0; y < cy; ++y) {
-		for (unsigned int z = 0; z < cz; ++z) {
-			if (pfn) {
-				pfn("Writing voxels", y + (cy * z), cy * cz);
-			}
-
-			for (unsigned int x = 0; x < cx; ++x) {
-				unsigned char block = 0;
-				unsigned char data  = 0;
-
-				toMCVoxel(v.voxel(x, y, z), block, data);
-				blocksv.push_back(block);
-				datasv.push_back(data);
-			}
+	size_t       slab  = size_t(cx) * cz;
+	unsigned int batch = std::min<unsigned int>(2 * par::threads(), cy);
+	BVec         blocksv(slab * batch);
+	BVec         datasv(slab * batch);
+	spool        datas;
+
+	convertSlabs f;
+	f.v      = &v;
+	f.blocks = &blocksv[0];
+	f.datas  = &datasv[0];
+
+	if (prog) {
+		prog->begin("Writing voxels", cy);
+	}
+	w.beginBytes("Blocks", int(cx * cy * cz));
+	for (f.y0 = 0; f.y0 < cy; f.y0 += batch) {
+		unsigned int n = std::min(batch, cy - f.y0);
+		par::each(n, f);
+
+		w.putBytes(&blocksv[0], slab * n);
+		datas.write(&datasv[0], slab * n);
+		if (prog) {
+			prog->add(n);
 		}
 	}
+	w.endBytes();
+
+	BVec buffer(64 * 1024);
+	w.beginBytes("Data", int(cx * cy * cz));
+	datas.copyTo(w, buffer);
+	w.endBytes();
+
+	w.beginArray("Entities", tuple::tagID(), 0);
+	w.endArray();
+	w.beginArray("TileEntities", tuple::tagID(), 0);
+	w.endArray();
 
-	// write the complete volume and we're done
-	write(x, out);
-	delete x;
+	// and we're done
+	w.endTuple();
+	out.close();
 }
 
 }
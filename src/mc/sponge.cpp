@@ -0,0 +1,126 @@
+
+#include <mc/sponge.hpp>
+#include <mc/blocks.hpp>
+#include <mc/spool.hpp>
+#include <mc/value.hpp>
+#include <mc/writer.hpp>
+#include <io/pgzip_stream.hpp>
+#include <str/Util.hpp>
+#include <stdexcept>
+
+namespace mc {
+
+// the game versions that each format version is written for (1.16.5 and 1.20.1)
+static const int spongeV2DataVersion = 2586;
+static const int spongeV3DataVersion = 3465;
+
+// append an unsigned LEB128 varint
+inline void putVarint(std::vector<unsigned char>& out, unsigned int x) {
+	while (x >= 0x80) {
+		out.push_back((unsigned char)(x & 0x7f) | 0x80);
+		x >>= 7;
+	}
+	out.push_back((unsigned char)x);
+}
+
+void saveSponge(const geom::volume& v, const std::string& filename, int version, par::progress* prog, const io::deflate_options& z) {
+	if (version != 2 && version != 3) {
+		throw std::runtime_error("Unsupported Sponge schematic version: " + str::to_string(version));
+	}
+
+	unsigned int cx = v.width();
+	unsigned int cy = v.height();
+	unsigned int cz = v.depth();
+
+	if (cx > 0xffff || cy > 0xffff || cz > 0xffff) {
+		throw std::runtime_error("Volume is too large for a Sponge schematic.");
+	}
+
+	// convert the volume in one pass (in x, z, y order) -- palette indexes are
+	// assigned as blocks are first seen, and block data is spooled until the
+	// palette is complete
+	std::vector<int>           paletteIndex(blockCount(), -1);
+	std::vector<block>         palette;
+	std::vector<color::value>  voxels(cx);
+	std::vector<unsigned char> row;
+	spool                      blockData;
+
+	if (prog) {
+		prog->begin("Writing voxels", (unsigned long)cy * cz);
+	}
+	row.reserve(cx * 5);
+	for (unsigned int y = 0; y < cy; ++y) {
+		for (unsigned int z = 0; z < cz; ++z) {
+			if (prog) {
+				prog->add();
+			}
+
+			v.readRow(0, y, z, cx, &voxels[0]);
+
+			row.clear();
+			for (unsigned int x = 0; x < cx; ++x) {
+				block b = nearestBlock(voxels[x]);
+
+				if (paletteIndex[b] < 0) {
+					paletteIndex[b] = int(palette.size());
+					palette.push_back(b);
+				}
+				putVarint(row, (unsigned int)paletteIndex[b]);
+			}
+			blockData.write(&row[0], row.size());
+		}
+	}
+
+	// then write out the schematic
+	io::pgzip_ostream out(filename, z);
+	writer w(out);
+
+	if (version == 3) {
+		w.beginTuple("");
+	}
+	w.beginTuple("Schematic");
+	w.put("Version",     version);
+	w.put("DataVersion", (version == 2) ? spongeV2DataVersion : spongeV3DataVersion);
+	w.put("Width",       short(cx));
+	w.put("Height",      short(cy));
+	w.put("Length",      short(cz));
+
+	int offset[] = { 0, 0, 0 };
+	w.beginInt4s("Offset", 3);
+	w.putInt4s(offset, 3);
+	w.endInt4s();
+
+	if (version == 3) {
+		w.beginTuple("Blocks");
+	} else {
+		w.put("PaletteMax", int(palette.size()));
+	}
+
+	w.beginTuple("Palette");
+	for (unsigned int i = 0; i < palette.size(); ++i) {
+		w.put(blockState(palette[i]), int(i));
+	}
+	w.endTuple();
+
+	std::vector<unsigned char> buffer(64 * 1024);
+	w.beginBytes((version == 3) ? "Data" : "BlockData", int(blockData.size()));
+	blockData.copyTo(w, buffer);
+	w.endBytes();
+
+	w.beginArray("BlockEntities", tuple::tagID(), 0);
+	w.endArray();
+
+	if (version == 3) {
+		w.endTuple();
+	}
+	w.endTuple();
+	if (version == 3) {
+		w.endTuple();
+	}
+
+	// and we're done
+	out.close();
+}
+
+}
+
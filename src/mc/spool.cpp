@@ -0,0 +1,38 @@
+
+#include <mc/spool.hpp>
+#include <stdexcept>
+
+namespace mc {
+
+spool::spool() : f(tmpfile()), n(0) {
+	if (this->f == 0) {
+		throw std::runtime_error("Unable to create a temporary file for schematic data.");
+	}
+}
+
+spool::~spool() {
+	fclose(this->f);
+}
+
+void spool::write(const unsigned char* xs, size_t n) {
+	if (fwrite(xs, 1, n, this->f) != n) {
+		throw std::runtime_error("Failed to write schematic data to a temporary file.");
+	}
+	this->n += n;
+}
+
+size_t spool::size() const {
+	return this->n;
+}
+
+void spool::copyTo(writer& w, std::vector<unsigned char>& buffer) {
+	rewind(this->f);
+
+	size_t n = 0;
+	while ((n = fread(&buffer[0], 1, buffer.size(), this->f)) > 0) {
+		w.putBytes(&buffer[0], n);
+	}
+}
+
+}
+
@@ -0,0 +1,152 @@
+
+#include <mc/tiles.hpp>
+#include <mc/sponge.hpp>
+#include <par/pool.hpp>
+#include <str/Util.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mc {
+
+struct tile {
+	unsigned int x, y, z;
+	unsigned int w, h, d;
+	std::string  file;
+	bool         empty;
+};
+typedef std::vector<tile> tileset;
+
+// (only non-empty runs are read, then checked against the alpha cut-off where voxels become air)
+bool allAir(const geom::volume& v) {
+	std::vector<color::value> row;
+
+	for (geom::runs r(v); !r.done(); ++r) {
+		const geom::span& s = r.point();
+		row.resize(s.n);
+		v.readRow(s.x, r.y(), r.z(), s.n, &row[0]);
+
+		for (unsigned int i = 0; i < s.n; ++i) {
+			if (color::alpha(row[i]) > 128) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool unchanged(const geom::volume& changes) {
+	return geom::runs(changes).done();
+}
+
+// check and write tiles (each compresses on the shared pool too, which just joins in)
+struct writeTiles {
+	const geom::volume* v;
+	const geom::volume* changed;
+	par::progress*      prog;
+	tileset*            ts;
+	std::string         directory;
+	std::string         format;
+	io::deflate_options z;
+
+	void operator()(unsigned int i) {
+		write((*ts)[i]);
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+
+	void write(tile& t) {
+		geom::subvolume sv(*v, t.x, t.y, t.z, t.w, t.h, t.d);
+		std::string     path = this->directory + "/" + t.file;
+
+		t.empty = allAir(sv);
+		if (this->changed && unchanged(geom::subvolume(*this->changed, t.x, t.y, t.z, t.w, t.h, t.d))) {
+			return; // (unchanged since the last time it was written)
+		} else if (t.empty) {
+			if (this->changed) {
+				unlink(path.c_str());
+			}
+			return;
+		}
+
+		if (this->format == "schematic") {
+			save(sv, path, 0, this->z);
+		} else {
+			saveSponge(sv, path, (this->format == "schem3") ? 3 : 2, 0, this->z);
+		}
+	}
+};
+
+void saveTiles(const geom::volume& v, const std::string& directory, unsigned int tileSize, const std::string& format, par::progress* prog, const io::deflate_options& z, const geom::volume* changed) {
+	if (tileSize == 0) {
+		throw std::runtime_error("Schematic tiles must be at least one block wide.");
+	} else if (format != "schematic" && format != "schem2" && format != "schem3") {
+		throw std::runtime_error("Unsupported schematic tile format: " + format);
+	}
+
+	if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+		throw std::runtime_error("Unable to create the tile directory '" + directory + "'.");
+	}
+
+	// cut the volume into tiles
+	std::string ext = (format == "schematic") ? ".schematic" : ".schem";
+	tileset     ts;
+
+	for (unsigned int y = 0; y < v.height(); y += tileSize) {
+		for (unsigned int z = 0; z < v.depth(); z += tileSize) {
+			for (unsigned int x = 0; x < v.width(); x += tileSize) {
+				tile t;
+				t.x     = x;
+				t.y     = y;
+				t.z     = z;
+				t.w     = std::min(tileSize, v.width()  - x);
+				t.h     = std::min(tileSize, v.height() - y);
+				t.d     = std::min(tileSize, v.depth()  - z);
+				t.file  = "tile." + str::to_string(x / tileSize) + "." + str::to_string(y / tileSize) + "." + str::to_string(z / tileSize) + ext;
+				t.empty = true;
+				ts.push_back(t);
+			}
+		}
+	}
+
+	// and write them (progress is counted as each one finishes)
+	writeTiles f;
+	f.v         = &v;
+	f.changed   = changed;
+	f.ts        = &ts;
+	f.directory = directory;
+	f.format    = format;
+	f.z         = z;
+
+	if (prog) {
+		prog->begin("Writing tiles", ts.size());
+	}
+	f.prog = prog;
+	par::each(ts.size(), f);
+
+	// and record where the tiles go
+	std::string   mfile = directory + "/manifest.txt";
+	std::ofstream m(mfile.c_str());
+	if (!m) {
+		throw std::runtime_error("Unable to open the tile manifest '" + mfile + "' for writing.");
+	}
+
+	m << "# " << v.width() << " " << v.height() << " " << v.depth() << " blocks in " << tileSize << "-block tiles" << std::endl
+	  << "# file x y z width height depth" << std::endl;
+	for (unsigned int i = 0; i < ts.size(); ++i) {
+		const tile& t = ts[i];
+		if (!t.empty) {
+			m << t.file << " " << t.x << " " << t.y << " " << t.z << " " << t.w << " " << t.h << " " << t.d << std::endl;
+		}
+	}
+
+	if (!m) {
+		throw std::runtime_error("Failed to write the tile manifest '" + mfile + "'.");
+	}
+}
+
+}
+
@@ -1,44 +1,11 @@
 
 #include <mc/value.hpp>
+#include <mc/pack.hpp>
 #include <str/Util.hpp>
 #include <stdexcept>
 
 namespace mc {
 
-// br :: Byte<N> -> Byte<N>
-//   byte-reverse
-template <typename T>
-	struct b {
-		static T r(T x) {
-			unsigned char* px = (unsigned char*)&x;
-			static const unsigned int n = sizeof(T) / 2;
-			static const unsigned int e = sizeof(T) - 1;
-	
-			for (unsigned int i = 0; i < n; ++i) {
-				unsigned char b = px[i];
-				px[i]     = px[e - i];
-				px[e - i] = b;
-			}
-			return x;
-		}
-	};
-
-template <typename T>
-	struct b< std::vector<T> > {
-		static std::vector<T> r(const std::vector<T>& xs) {
-			std::vector<T> result;
-			for (typename std::vector<T>::const_iterator x = xs.begin(); x != xs.end(); ++x) {
-				result.push_back(b<T>::r(*x));
-			}
-			return result;
-		}
-	};
-
-template <typename T>
-	T br(const T& x) {
-		return b<T>::r(x);
-	}
-
 // showNyb :: Char/2 -> Char
 inline char showNyb(unsigned char x) {
 	static const char cs[] = "0123456789abcdef";
@@ -56,28 +23,7 @@ inline std::string showByte(unsigned char x) {
 }
 
 // put :: Pack a => Ostream -> a -> ()
-#define DECL_PUT(X) \
-	inline void put(std::ostream& out, X x) { \
-		X nx = br<X>(x); \
-		out.write((const char*)(&nx), sizeof(X)); \
-	}
-
-DECL_PUT(unsigned char);
-DECL_PUT(short);
-DECL_PUT(int);
-DECL_PUT(long);
-DECL_PUT(float);
-DECL_PUT(double);
-
-inline void put(std::ostream& out, const char* x, short n) {
-	put(out, n);
-	out.write(x, n);
-}
-
-inline void put(std::ostream& out, const std::string& x) {
-	put(out, x.c_str(), short(x.size()));
-}
-
+//   (scalars are in mc/pack.hpp)
 inline void put(std::ostream& out, const std::vector<unsigned char>& xs) {
 	put(out, int(xs.size()));
 	if (xs.size() > 0) {
@@ -86,10 +32,16 @@ inline void put(std::ostream& out, const std::vector<unsigned char>& xs) {
 }
 
 inline void put(std::ostream& out, const std::vector<int>& xs) {
-	std::vector<int> rxs = br(xs);
-	put(out, int(rxs.size()));
-	if (rxs.size() > 0) {
-		out.write((const char*)&(*(rxs.begin())), sizeof(int) * rxs.size());
+	put(out, int(xs.size()));
+	if (xs.size() > 0) {
+		putArray(out, &(*(xs.begin())), xs.size());
+	}
+}
+
+inline void put(std::ostream& out, const std::vector<long long>& xs) {
+	put(out, int(xs.size()));
+	if (xs.size() > 0) {
+		putArray(out, &(*(xs.begin())), xs.size());
 	}
 }
 
@@ -158,7 +110,18 @@ void get(std::istream& in, std::vector<int>& xs) {
 	xs.resize(len);
 	if (len > 0) {
 		in.read((char*)&(*(xs.begin())), sizeof(int) * len);
-		xs = br(xs);
+		swap32(&(*(xs.begin())), &(*(xs.begin())), len);
+	}
+}
+
+void get(std::istream& in, std::vector<long long>& xs) {
+	int len = 0;
+	get(in, len);
+
+	xs.resize(len);
+	if (len > 0) {
+		in.read((char*)&(*(xs.begin())), sizeof(long long) * len);
+		swap64(&(*(xs.begin())), &(*(xs.begin())), len);
 	}
 }
 
@@ -176,6 +139,7 @@ value* make(tagid tid, const char* name, std::istream& in) {
 	CC(array);
 	CC(tuple);
 	CC(int4s);
+	CC(int8s);
 
 	throw std::runtime_error("Failed to decode value -- invalid tag #" + str::to_string(tid));
 }
@@ -251,6 +215,7 @@ DECL_BOX_FMT(string, 8, "\"" << x << "\"");
 DECL_BOX    (array,  9);
 DECL_BOX    (tuple,  10);
 DECL_BOX    (int4s,  11);
+DECL_BOX    (int8s,  12);
 
 // byte arrays
 void bytes::show(std::ostream& out) const {
@@ -276,6 +241,19 @@ void int4s::show(std::ostream& out) const {
 	out << "|";
 }
 
+// long arrays
+void int8s::show(std::ostream& out) const {
+	out << "|";
+	if (this->x.size() > 0) {
+		out << this->x[0] << "L";
+		for (size_t i = 1; i < this->x.size(); ++i) {
+			out << ";";
+			out << this->x[i] << "L";
+		}
+	}
+	out << "|";
+}
+
 // value sequence of homogeneous type
 void array::show(std::ostream& out) const {
 	out << "[ty=" << int(this->x.first) << ";";
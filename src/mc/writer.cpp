@@ -0,0 +1,152 @@
+
+#include <mc/writer.hpp>
+#include <mc/pack.hpp>
+#include <str/Util.hpp>
+#include <stdexcept>
+#include <string.h>
+
+namespace mc {
+
+writer::frame::frame(tagid tag, tagid etag, int remaining) : tag(tag), etag(etag), remaining(remaining) {
+}
+
+writer::writer(std::ostream& out) : out(out) {
+}
+
+bool writer::done() const {
+	return this->stack.empty();
+}
+
+// write the tag/name prefix of a value (or just count it off, if it's in a list)
+void writer::header(tagid tid, const char* name) {
+	if (!this->stack.empty()) {
+		frame& f = this->stack.back();
+
+		if (f.tag == array::tagID()) {
+			if (f.etag != tid) {
+				throw std::runtime_error("Can't write tag #" + str::to_string(int(tid)) + " into a list of tag #" + str::to_string(int(f.etag)));
+			} else if (f.remaining <= 0) {
+				throw std::runtime_error("Too many values written to a list.");
+			}
+
+			--f.remaining;
+			return;
+		} else if (f.tag != tuple::tagID()) {
+			throw std::runtime_error("Can't write a value into the middle of an array payload.");
+		}
+	}
+
+	mc::put(this->out, tid);
+	mc::put(this->out, name, short(strlen(name)));
+}
+
+void writer::chunk(tagid tid, unsigned int n) {
+	if (this->stack.empty() || this->stack.back().tag != tid) {
+		throw std::runtime_error("Array data written outside of its array.");
+	}
+
+	frame& f = this->stack.back();
+	if (int(n) > f.remaining) {
+		throw std::runtime_error("Too much data written to an array (" + str::to_string(n) + " > " + str::to_string(f.remaining) + ")");
+	}
+	f.remaining -= n;
+}
+
+void writer::end(tagid tid) {
+	if (this->stack.empty() || this->stack.back().tag != tid) {
+		throw std::runtime_error("Mismatched end of tag #" + str::to_string(int(tid)));
+	} else if (this->stack.back().remaining > 0) {
+		throw std::runtime_error("Value of tag #" + str::to_string(int(tid)) + " ended " + str::to_string(this->stack.back().remaining) + " elements short.");
+	}
+
+	this->stack.pop_back();
+}
+
+// compounds
+void writer::beginTuple(const char* name) {
+	header(tuple::tagID(), name);
+	this->stack.push_back(frame(tuple::tagID(), 0, 0));
+}
+
+void writer::endTuple() {
+	end(tuple::tagID());
+	mc::put(this->out, (unsigned char)0);
+}
+
+// lists
+void writer::beginArray(const char* name, tagid etag, int count) {
+	header(array::tagID(), name);
+	mc::put(this->out, etag);
+	mc::put(this->out, count);
+	this->stack.push_back(frame(array::tagID(), etag, count));
+}
+
+void writer::endArray() {
+	end(array::tagID());
+}
+
+// scalars
+#define DECL_WRITER_PUT(T, B) \
+	void writer::put(const char* name, T x) { \
+		header(B::tagID(), name); \
+		mc::put(this->out, x); \
+	}
+
+DECL_WRITER_PUT(unsigned char,      byte);
+DECL_WRITER_PUT(short,              int2);
+DECL_WRITER_PUT(int,                int4);
+DECL_WRITER_PUT(long,               int8);
+DECL_WRITER_PUT(float,              float4);
+DECL_WRITER_PUT(double,             float8);
+DECL_WRITER_PUT(const std::string&, string);
+
+// byte arrays
+void writer::beginBytes(const char* name, int count) {
+	header(bytes::tagID(), name);
+	mc::put(this->out, count);
+	this->stack.push_back(frame(bytes::tagID(), 0, count));
+}
+
+void writer::putBytes(const unsigned char* xs, unsigned int n) {
+	chunk(bytes::tagID(), n);
+	this->out.write((const char*)xs, n);
+}
+
+void writer::endBytes() {
+	end(bytes::tagID());
+}
+
+// int arrays
+void writer::beginInt4s(const char* name, int count) {
+	header(int4s::tagID(), name);
+	mc::put(this->out, count);
+	this->stack.push_back(frame(int4s::tagID(), 0, count));
+}
+
+void writer::putInt4s(const int* xs, unsigned int n) {
+	chunk(int4s::tagID(), n);
+	putArray(this->out, xs, n);
+}
+
+void writer::endInt4s() {
+	end(int4s::tagID());
+}
+
+// long arrays
+void writer::beginInt8s(const char* name, int count) {
+	header(int8s::tagID(), name);
+	mc::put(this->out, count);
+	this->stack.push_back(frame(int8s::tagID(), 0, count));
+}
+
+void writer::putInt8s(const long long* xs, unsigned int n) {
+	chunk(int8s::tagID(), n);
+	putArray(this->out, xs, n);
+}
+
+void writer::endInt8s() {
+	end(int8s::tagID());
+}
+
+}
+
@@ -1,8 +1,10 @@
 
 #include <obj/reader.hpp>
+#include <algorithm>
 #include <fstream>
 #include <stdexcept>
 #include <vector>
+#include <stdlib.h>
 
 namespace obj {
 
@@ -15,19 +17,104 @@ const geom::triset& reader::faces() const {
 	return this->data;
 }
 
-reader::reader(const std::string& filename, PROGRESSFN pfn) : currentTexture(0) {
+// the number of faces streamed at a time
+static const size_t faceBatchSize = 4096;
+
+faceSink::~faceSink() {
+}
+
+void vertexBounds(const std::string& filename, geom::point& lo, geom::point& hi) {
 	std::ifstream f(filename.c_str());
 	if (!f.is_open()) {
 		throw std::runtime_error("Couldn't open OBJ file '" + filename + "' for reading.");
 	}
 
-	if (pfn) { pfn("Loading '" + filename + "'", 0, 1); }
+	bool        any = false;
+	std::string line;
+	while (std::getline(f, line)) {
+		const char* p = line.c_str();
+		while (*p == ' ' || *p == '\t') {
+			++p;
+		}
+		if (p[0] != 'v' || (p[1] != ' ' && p[1] != '\t')) {
+			continue;
+		}
+
+		char*  e = 0;
+		double x = strtod(p + 2, &e);
+		double y = strtod(e, &e);
+		double z = strtod(e, &e);
+
+		if (!any) {
+			lo  = hi = geom::point(x, y, z);
+			any = true;
+		} else {
+			lo.x = std::min(lo.x, x); hi.x = std::max(hi.x, x);
+			lo.y = std::min(lo.y, y); hi.y = std::max(hi.y, y);
+			lo.z = std::min(lo.z, z); hi.z = std::max(hi.z, z);
+		}
+	}
+
+	if (!any) {
+		throw std::runtime_error("The OBJ file '" + filename + "' has no vertices.");
+	}
+}
+
+reader::reader(const std::string& filename, par::progress* prog) : sink(0), currentTexture(0) {
+	read(filename, prog);
+}
+
+reader::reader(const std::string& filename, faceSink& out, par::progress* prog) : sink(&out), currentTexture(0) {
+	this->batch.reserve(faceBatchSize);
+	try {
+		read(filename, prog);
+
+		if (!this->batch.empty()) {
+			this->sink->faces(this->batch);
+			this->batch.clear();
+		}
+	} catch (...) {
+		this->sink->finished();
+		throw;
+	}
+	this->sink->finished();
+}
+
+void reader::addFace(const geom::triangle& tri) {
+	if (this->sink == 0) {
+		this->data.append(tri);
+		return;
+	}
+
+	this->batch.push_back(tri);
+	if (this->batch.size() == faceBatchSize) {
+		this->sink->faces(this->batch);
+		this->batch.clear();
+	}
+}
+
+void reader::read(const std::string& filename, par::progress* prog) {
+	std::ifstream f(filename.c_str());
+	if (!f.is_open()) {
+		throw std::runtime_error("Couldn't open OBJ file '" + filename + "' for reading.");
+	}
+
+	// (progress is counted in bytes)
+	if (prog) {
+		f.seekg(0, std::ios::end);
+		std::streamoff n = f.tellg();
+		f.seekg(0, std::ios::beg);
+		prog->begin("Loading '" + filename + "'", (unsigned long)(n > 0 ? n : 0));
+	}
 
 	std::string basedir = basepath(filename);
 
 	while (f) {
 		std::string line;
 		std::getline(f, line);
+		if (prog) {
+			prog->add(line.size() + 1);
+		}
 		line = str::trim(line);
 		if (line.size() == 0 || line[0] == '#') continue;
 
@@ -38,8 +125,17 @@ reader::reader(const std::string& filename, PROGRESSFN pfn) : currentTexture(0)
 
 		processCommand(basedir, cmd[0], ObjCmd(cmd.begin() + 1, cmd.end()));
 	}
+}
+
+// MTL colors are given as [0,1] reals
+inline color::channel unitChannel(const std::string& x) {
+	double v = str::from_string<double>(x);
+	return color::channel(std::max(0.0, std::min(1.0, v)) * 255.0 + 0.5);
+}
 
-	if (pfn) { pfn("Loading '" + filename + "'", 1, 1); }
+inline void setAlpha(color::texture& t, color::channel a) {
+	color::value c = t.flatColor();
+	t.fill(color::make(color::red(c), color::green(c), color::blue(c), a));
 }
 
 void reader::readTextures(const std::string& texFile) {
@@ -62,6 +158,13 @@ void reader::readTextures(const std::string& texFile) {
 			this->textures[texName] = color::texture();
 		} else if (cmd[0] == "map_Kd") {
 			this->textures[texName].load(basepath(texFile) + "/" + cmd[1]);
+		} else if (cmd[0] == "Kd" && cmd.size() >= 4) {
+			color::texture& t = this->textures[texName];
+			t.fill(color::make(unitChannel(cmd[1]), unitChannel(cmd[2]), unitChannel(cmd[3]), color::alpha(t.flatColor())));
+		} else if (cmd[0] == "d" && cmd.size() >= 2) {
+			setAlpha(this->textures[texName], unitChannel(cmd[1]));
+		} else if (cmd[0] == "Tr" && cmd.size() >= 2) {
+			setAlpha(this->textures[texName], 0xff - unitChannel(cmd[1]));
 		}
 	}
 }
@@ -88,11 +191,11 @@ void reader::processCommand(const std::string& basedir, const std::string& cn, c
 			throw std::runtime_error("Invalid OBJ texture coord command: " + line(cn, args));
 		}
 	} else if (cn == "f") {
-		if (args.size() == 3) {
-			this->data.append(geom::triangle(point(args[0]), point(args[1]), point(args[2]), this->currentTexture));
-		} else if (args.size() == 4) {
-			this->data.append(geom::triangle(point(args[0]), point(args[1]), point(args[2]), this->currentTexture));
-			this->data.append(geom::triangle(point(args[1]), point(args[2]), point(args[3]), this->currentTexture));
+		if (args.size() >= 3) {
+			// polygons are fanned out from their first vertex (which keeps every triangle wound the same way)
+			for (unsigned int i = 2; i < args.size(); ++i) {
+				addFace(geom::triangle(point(args[0]), point(args[i - 1]), point(args[i]), this->currentTexture));
+			}
 		} else {
 			throw std::runtime_error("Invalid OBJ face command: " + line(cn, args));
 		}
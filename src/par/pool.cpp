@@ -0,0 +1,164 @@
+
+#include <par/pool.hpp>
+#include <unistd.h>
+
+namespace par {
+
+unsigned int cores() {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (unsigned int)n : 1;
+}
+
+task::~task() {
+}
+
+group::group() : pending(0), failed(false) {
+}
+
+// the worker thread pool
+pool::pool(unsigned int n) : stopping(false) {
+	pthread_mutex_init(&this->mutex, 0);
+	pthread_cond_init(&this->ready, 0);
+	pthread_cond_init(&this->finished, 0);
+
+	for (unsigned int i = 0; i < n; ++i) {
+		pthread_t t;
+		if (pthread_create(&t, 0, &pool::work, this) != 0) {
+			break;
+		}
+		this->workers.push_back(t);
+	}
+}
+
+pool::~pool() {
+	pthread_mutex_lock(&this->mutex);
+	this->stopping = true;
+	pthread_cond_broadcast(&this->ready);
+	pthread_mutex_unlock(&this->mutex);
+
+	for (threads::const_iterator t = this->workers.begin(); t != this->workers.end(); ++t) {
+		pthread_join(*t, 0);
+	}
+
+	pthread_cond_destroy(&this->finished);
+	pthread_cond_destroy(&this->ready);
+	pthread_mutex_destroy(&this->mutex);
+}
+
+unsigned int pool::size() const {
+	return this->workers.size();
+}
+
+void pool::push(task* t, group& g) {
+	item i;
+	i.t = t;
+	i.g = &g;
+
+	pthread_mutex_lock(&this->mutex);
+	++g.pending;
+	this->queue.push_back(i);
+	pthread_cond_signal(&this->ready);
+	pthread_mutex_unlock(&this->mutex);
+}
+
+void pool::wait(group& g) {
+	pthread_mutex_lock(&this->mutex);
+	while (g.pending > 0) {
+		if (!this->queue.empty()) {
+			item i = this->queue.front();
+			this->queue.pop_front();
+
+			pthread_mutex_unlock(&this->mutex);
+			exec(i);
+			pthread_mutex_lock(&this->mutex);
+		} else {
+			pthread_cond_wait(&this->finished, &this->mutex);
+		}
+	}
+
+	bool        failed = g.failed;
+	std::string error  = g.error;
+	g.failed = false;
+	g.error.clear();
+	pthread_mutex_unlock(&this->mutex);
+
+	if (failed) {
+		throw std::runtime_error(error);
+	}
+}
+
+// run a task (without the lock held) and account for it in its group
+void pool::exec(const item& i) {
+	std::string error;
+	bool        failed = false;
+
+	try {
+		i.t->run();
+	} catch (std::exception& ex) {
+		error  = ex.what();
+		failed = true;
+	} catch (...) {
+		error  = "Unknown failure in worker task.";
+		failed = true;
+	}
+
+	pthread_mutex_lock(&this->mutex);
+	if (failed && !i.g->failed) {
+		i.g->failed = true;
+		i.g->error  = error;
+	}
+	--i.g->pending;
+	pthread_cond_broadcast(&this->finished);
+	pthread_mutex_unlock(&this->mutex);
+}
+
+void* pool::work(void* p) {
+	pool* self = (pool*)p;
+
+	pthread_mutex_lock(&self->mutex);
+	while (true) {
+		while (self->queue.empty() && !self->stopping) {
+			pthread_cond_wait(&self->ready, &self->mutex);
+		}
+
+		if (self->queue.empty()) {
+			break;
+		}
+
+		item i = self->queue.front();
+		self->queue.pop_front();
+
+		pthread_mutex_unlock(&self->mutex);
+		self->exec(i);
+		pthread_mutex_lock(&self->mutex);
+	}
+	pthread_mutex_unlock(&self->mutex);
+
+	return 0;
+}
+
+// the process-wide pool
+static unsigned int   requestedThreads = 0;
+static pool*          sharedPool       = 0;
+static pthread_once_t sharedOnce       = PTHREAD_ONCE_INIT;
+
+void setThreads(unsigned int n) {
+	requestedThreads = n;
+}
+
+unsigned int threads() {
+	return (requestedThreads > 0) ? requestedThreads : cores();
+}
+
+// the calling thread always does its share of the work, so the pool needs one thread less
+static void initShared() {
+	sharedPool = new pool(threads() - 1);
+}
+
+pool& shared() {
+	pthread_once(&sharedOnce, &initShared);
+	return *sharedPool;
+}
+
+}
+
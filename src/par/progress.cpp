@@ -0,0 +1,176 @@
+
+#include <par/progress.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace par {
+
+double now() {
+	timeval tv; memset(&tv, 0, sizeof(tv));
+	gettimeofday(&tv, 0);
+	return double(tv.tv_sec) * 1000.0 + double(tv.tv_usec) / 1000.0;
+}
+
+/*
+ * progress
+ */
+progress::progress() : id(0), total(0), started(now()), done(0) {
+	pthread_mutex_init(&this->mutex, 0);
+	this->last.id      = 0;
+	this->last.done    = 0;
+	this->last.total   = 0;
+	this->last.started = this->started;
+}
+
+progress::~progress() {
+	pthread_mutex_destroy(&this->mutex);
+}
+
+void progress::begin(const std::string& step, unsigned long total) {
+	pthread_mutex_lock(&this->mutex);
+	this->last.id      = this->id;
+	this->last.step    = this->step;
+	this->last.done    = __atomic_load_n(&this->done, __ATOMIC_RELAXED);
+	this->last.total   = this->total;
+	this->last.started = this->started;
+
+	++this->id;
+	this->step    = step;
+	this->total   = total;
+	this->started = now();
+	__atomic_store_n(&this->done, 0, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&this->mutex);
+}
+
+void progress::read(status& current, status& previous) const {
+	pthread_mutex_lock(&this->mutex);
+	current.id      = this->id;
+	current.step    = this->step;
+	current.done    = __atomic_load_n(&this->done, __ATOMIC_RELAXED);
+	current.total   = this->total;
+	current.started = this->started;
+	previous        = this->last;
+	pthread_mutex_unlock(&this->mutex);
+}
+
+/*
+ * reporter
+ */
+reporter::reporter(const progress& p, int fd, std::ostream& out, unsigned int intervalMS) : p(p), out(out), intervalMS(intervalMS), running(false), stopping(false), shown(0) {
+	pthread_mutex_init(&this->mutex, 0);
+	pthread_cond_init(&this->wake, 0);
+
+	if (isatty(fd)) {
+		this->running = (pthread_create(&this->thread, 0, &reporter::run, this) == 0);
+	}
+}
+
+reporter::~reporter() {
+	if (this->running) {
+		pthread_mutex_lock(&this->mutex);
+		this->stopping = true;
+		pthread_cond_signal(&this->wake);
+		pthread_mutex_unlock(&this->mutex);
+		pthread_join(this->thread, 0);
+
+		// (the last word on the last step)
+		draw();
+		this->out << std::endl;
+	}
+
+	pthread_cond_destroy(&this->wake);
+	pthread_mutex_destroy(&this->mutex);
+}
+
+void* reporter::run(void* p) {
+	reporter* self = (reporter*)p;
+
+	pthread_mutex_lock(&self->mutex);
+	while (!self->stopping) {
+		timespec t;
+		double   until = now() + self->intervalMS;
+		t.tv_sec  = time_t(until / 1000.0);
+		t.tv_nsec = long((until - double(t.tv_sec) * 1000.0) * 1000000.0);
+		if (t.tv_nsec >= 1000000000L) {
+			++t.tv_sec;
+			t.tv_nsec -= 1000000000L;
+		}
+
+		if (pthread_cond_timedwait(&self->wake, &self->mutex, &t) == ETIMEDOUT) {
+			pthread_mutex_unlock(&self->mutex);
+			self->draw();
+			pthread_mutex_lock(&self->mutex);
+		}
+	}
+	pthread_mutex_unlock(&self->mutex);
+
+	return 0;
+}
+
+void describe(std::ostream& out, const progress::status& s) {
+	out << s.step;
+	if (s.total == 0 || s.done == 0) {
+		return;
+	}
+
+	double p = std::min(1.0, double(s.done) / double(s.total));
+	out << " (" << 100.0 * p << "%";
+	if (p < 1.0) {
+		double e = now() - s.started;
+		double r = (e / p) - e;
+
+		static const double s1 = 1000.0;
+		static const double m1 = s1 * 60.0;
+		static const double h1 = m1 * 60.0;
+		static const double d1 = h1 * 24.0;
+
+		out << ", ";
+		if (r < s1) {
+			out << r << "ms";
+		} else if (r < m1) {
+			out << r / s1 << "s";
+		} else if (r < h1) {
+			out << r / m1 << "m";
+		} else if (r < d1) {
+			out << r / h1 << "h";
+		} else {
+			out << r / d1 << "d";
+		}
+		out << " remain";
+	}
+	out << ")";
+}
+
+void clearLine(std::ostream& out) {
+	out << char(0x0D);
+	for (int i = 0; i < 70; ++i) {
+		out << ' ';
+	}
+	out << char(0x0D);
+}
+
+// redraw the current step (finishing off any step that ended since the last draw)
+void reporter::draw() {
+	progress::status current, previous;
+	this->p.read(current, previous);
+
+	if (current.id != this->shown && previous.id != 0) {
+		clearLine(this->out);
+		describe(this->out, previous);
+		this->out << std::endl;
+	}
+	this->shown = current.id;
+
+	if (current.id != 0) {
+		clearLine(this->out);
+		describe(this->out, current);
+		this->out << std::flush;
+	}
+}
+
+}
+
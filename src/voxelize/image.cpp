@@ -1,24 +1,37 @@
-
 #include <voxelize/image.hpp>
+#include <color/resize.hpp>
+#include <algorithm>
+#include <string.h>
 
 namespace voxelize {
 
-image::image(unsigned int maxVoxExt, const std::string& file) {
-	this->img.read(file);
+image::image(unsigned int maxVoxExt, const std::string& file) : w(0), h(0) {
+	color::image img;
+	color::read(file, img);
+
+	if (img.width > 0 && img.height > 0 && maxVoxExt > 0) {
+		double pixelsPerVoxel = double(std::max(img.width, img.height)) / double(maxVoxExt);
+
+		this->w = std::max(1u, (unsigned int)(double(img.width)  / pixelsPerVoxel));
+		this->h = std::max(1u, (unsigned int)(double(img.height) / pixelsPerVoxel));
 
-	Magick::Geometry ext = img.boundingBox();
-	double pixelsPerVoxel = double((ext.width() > ext.height()) ? ext.width() : ext.height()) / double(maxVoxExt);
+		// (turning the image upright as it's copied in)
+		color::image small;
+		color::resize(img, this->w, this->h, small);
 
-	Magick::Geometry resized(size_t(double(ext.width()) / pixelsPerVoxel), size_t(double(ext.height()) / pixelsPerVoxel));
-	img.sample(resized);
+		this->data.resize(small.data.size());
+		for (unsigned int y = 0; y < this->h; ++y) {
+			memcpy(&this->data[size_t(y) * this->w], &small.data[size_t(this->h - 1 - y) * this->w], this->w * sizeof(color::value));
+		}
+	}
 }
 
 unsigned int image::width()  const {
-	return this->img.boundingBox().width();
+	return this->w;
 }
 
 unsigned int image::height() const {
-	return this->img.boundingBox().height();
+	return this->h;
 }
 
 unsigned int image::depth()  const {
@@ -26,13 +39,16 @@ unsigned int image::depth()  const {
 }
 
 color::value image::voxel(unsigned int x, unsigned int y, unsigned int z) const {
-	if (x >= width() || y > height() || z != 0) {
+	if (x >= this->w || y >= this->h || z != 0) {
 		return color::make(0x00, 0x00, 0x00, 0x00);
 	} else {
-		const Magick::PixelPacket* p = this->img.getConstPixels(x, height() - y, 1, 1);
-		return color::make(p->red, p->green, p->blue, 0xff - p->opacity);
+		return this->data[size_t(y) * this->w + x];
 	}
 }
 
+void image::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	geom::readDenseRow(this->data.empty() ? 0 : &this->data[0], this->w, this->h, 1, x, y, z, n, out);
+}
+
 }
 
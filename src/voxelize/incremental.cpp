@@ -0,0 +1,488 @@
+
+#include <voxelize/incremental.hpp>
+#include <voxelize/raster.hpp>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <stdio.h>
+#include <string.h>
+
+namespace voxelize {
+
+static const char         stateMagic[8] = { 'm', 'c', 'v', 'o', 'x', 'i', 'n', 'c' };
+static const unsigned int stateVersion  = 1;
+
+// FNV-1a, over the bytes of whatever's hashed
+inline void hash(unsigned long long& h, const void* p, size_t n) {
+	const unsigned char* b = (const unsigned char*)p;
+	for (size_t i = 0; i < n; ++i) {
+		h = (h ^ b[i]) * 0x100000001b3ULL;
+	}
+}
+
+static const unsigned long long hashSeed = 0xcbf29ce484222325ULL;
+
+unsigned long long textureHash(const color::texture& t) {
+	unsigned long long h  = hashSeed;
+	unsigned int       tw = t.width();
+	unsigned int       th = t.height();
+	color::value       kd = t.flatColor();
+	hash(h, &tw, sizeof(tw));
+	hash(h, &th, sizeof(th));
+	hash(h, &kd, sizeof(kd));
+
+	for (unsigned int y = 0; y < th; ++y) {
+		for (unsigned int x = 0; x < tw; ++x) {
+			color::value c = t.texel(int(x), int(y));
+			hash(h, &c, sizeof(c));
+		}
+	}
+	return h;
+}
+
+// the samples of added triangles go into their voxels' sums, and those of removed triangles come back out
+struct addSamples {
+	incremental* v;
+
+	void put(unsigned int x, unsigned int y, unsigned int z, color::value c) {
+		colorSum* s = v->cell(x, y, z);
+		s->r += color::red(c);
+		s->g += color::green(c);
+		s->b += color::blue(c);
+		s->a += color::alpha(c);
+		++s->n;
+
+		v->changed[v->index(x, y, z)] = true;
+	}
+};
+
+struct removeSamples {
+	incremental* v;
+
+	void put(unsigned int x, unsigned int y, unsigned int z, color::value c) {
+		unsigned int i = v->index(x, y, z);
+		colorSum*    s = v->data[i];
+		if (s == 0 || s->r < color::red(c) || s->g < color::green(c) || s->b < color::blue(c) || s->a < color::alpha(c)) {
+			throw std::runtime_error("The saved voxel state doesn't match the triangles saved with it.");
+		}
+
+		s->r -= color::red(c);
+		s->g -= color::green(c);
+		s->b -= color::blue(c);
+		s->a -= color::alpha(c);
+		if (--s->n == 0) {
+			delete s;
+			v->data[i] = 0;
+		}
+
+		v->changed[i] = true;
+	}
+};
+
+// (sorts triangle records by hash, through an index)
+struct byHash {
+	const std::vector<unsigned long long>* hs;
+
+	bool operator()(unsigned int a, unsigned int b) const {
+		return (*hs)[a] < (*hs)[b];
+	}
+};
+
+std::vector<unsigned int> hashOrder(const std::vector<unsigned long long>& hs) {
+	std::vector<unsigned int> r(hs.size());
+	for (unsigned int i = 0; i < r.size(); ++i) {
+		r[i] = i;
+	}
+
+	byHash cmp;
+	cmp.hs = &hs;
+	std::sort(r.begin(), r.end(), cmp);
+	return r;
+}
+
+incremental::incremental(unsigned int maxVoxExt, const geom::triset& mesh, const std::string& stateFile, const std::string& key, par::progress* prog) : maxVoxExt(0), w(0), h(0), d(0), data(0), isReused(false), allChanged(true), nAdded(0), nRemoved(0), mask(*this) {
+	aabb   bs(mesh.minX(), mesh.maxX(), mesh.minY(), mesh.maxY(), mesh.minZ(), mesh.maxZ());
+	double bv[] = { bs.x0, bs.x1, bs.y0, bs.y1, bs.z0, bs.z1 };
+	grid   g(maxVoxExt, bs);
+
+	// identify the mesh's textures and triangles
+	typedef std::map<const color::texture*, unsigned int> textureIDs;
+	textureIDs      tids;
+	textureRecords  nts;
+	triangleRecords nrs(mesh.size());
+
+	for (unsigned int i = 0; i < nrs.size(); ++i) {
+		geom::triangle  t = mesh[i];
+		triangleRecord& r = nrs[i];
+
+		r.texture = noTexture;
+		if (t.texture) {
+			textureIDs::const_iterator ti = tids.find(t.texture);
+			if (ti == tids.end()) {
+				textureRecord tr;
+				tr.hash = textureHash(*t.texture);
+				tr.flat = t.texture->flat() ? 1 : 0;
+				tr.kd   = t.texture->flatColor();
+				ti = tids.insert(textureIDs::value_type(t.texture, nts.size())).first;
+				nts.push_back(tr);
+			}
+			r.texture = ti->second;
+		}
+
+		const geom::point* ps[] = { &t.p0, &t.p1, &t.p2 };
+		for (unsigned int p = 0; p < 3; ++p) {
+			r.ps[5 * p + 0] = ps[p]->x;
+			r.ps[5 * p + 1] = ps[p]->y;
+			r.ps[5 * p + 2] = ps[p]->z;
+			r.ps[5 * p + 3] = ps[p]->u;
+			r.ps[5 * p + 4] = ps[p]->v;
+		}
+
+		unsigned long long th = (r.texture == noTexture) ? 0 : nts[r.texture].hash;
+		r.hash = hashSeed;
+		hash(r.hash, r.ps, sizeof(r.ps));
+		hash(r.hash, &th, sizeof(th));
+	}
+
+	// pick up the saved state, if it was made for the same voxels
+	this->isReused = load(stateFile) && this->maxVoxExt == maxVoxExt && memcmp(this->bounds, bv, sizeof(bv)) == 0 && this->w == g.w && this->h == g.h && this->d == g.d;
+
+	// removed triangles are rebuilt from their records, so their textures have to still be around
+	std::map<unsigned long long, color::texture*> byContent;
+	for (textureIDs::const_iterator ti = tids.begin(); ti != tids.end(); ++ti) {
+		byContent[nts[ti->second].hash] = const_cast<color::texture*>(ti->first);
+	}
+
+	std::vector<color::texture>  flats(this->textures.size());
+	std::vector<color::texture*> oldTextures(this->textures.size(), (color::texture*)0);
+	for (unsigned int i = 0; i < this->textures.size(); ++i) {
+		const textureRecord& tr = this->textures[i];
+		if (tr.flat) {
+			flats[i].fill(tr.kd);
+			oldTextures[i] = &flats[i];
+		} else if (byContent.count(tr.hash) > 0) {
+			oldTextures[i] = byContent[tr.hash];
+		} else {
+			this->isReused = false;
+		}
+	}
+
+	if (!this->isReused) {
+		reset();
+		this->maxVoxExt = maxVoxExt;
+		memcpy(this->bounds, bv, sizeof(bv));
+		this->w = g.w;
+		this->h = g.h;
+		this->d = g.d;
+		alloc();
+	}
+
+	this->allChanged = !this->isReused || this->key != key;
+	this->key        = key;
+	this->changed.assign(size_t(this->w) * this->h * this->d, false);
+
+	// diff the saved triangles against the mesh (as multisets, since a mesh may repeat a triangle)
+	std::vector<unsigned long long> ohs(this->tris.size()), nhs(nrs.size());
+	for (unsigned int i = 0; i < ohs.size(); ++i) { ohs[i] = this->tris[i].hash; }
+	for (unsigned int i = 0; i < nhs.size(); ++i) { nhs[i] = nrs[i].hash; }
+	std::vector<unsigned int> oo = hashOrder(ohs), no = hashOrder(nhs);
+
+	std::vector<unsigned int> removed, added;
+	unsigned int              oi = 0, ni = 0;
+	while (oi < oo.size() || ni < no.size()) {
+		if (ni == no.size() || (oi < oo.size() && ohs[oo[oi]] < nhs[no[ni]])) {
+			removed.push_back(oo[oi++]);
+		} else if (oi == oo.size() || nhs[no[ni]] < ohs[oo[oi]]) {
+			added.push_back(no[ni++]);
+		} else {
+			++oi;
+			++ni;
+		}
+	}
+	std::sort(removed.begin(), removed.end());
+	std::sort(added.begin(), added.end());
+
+	// take the old triangles out, and put the new ones in
+	removeSamples rs;
+	rs.v = this;
+	if (prog) {
+		prog->begin("Removing triangles", removed.size());
+	}
+	for (unsigned int i = 0; i < removed.size(); ++i) {
+		if (prog) {
+			prog->add();
+		}
+
+		const triangleRecord& r = this->tris[removed[i]];
+		color::texture*       t = (r.texture == noTexture) ? 0 : oldTextures[r.texture];
+		geom::triangle        tri(geom::point(r.ps[0], r.ps[1], r.ps[2], r.ps[3], r.ps[4]), geom::point(r.ps[5], r.ps[6], r.ps[7], r.ps[8], r.ps[9]), geom::point(r.ps[10], r.ps[11], r.ps[12], r.ps[13], r.ps[14]), t);
+
+		rasterize(g.place(tri), this->w, this->h, this->d, rs);
+	}
+
+	addSamples as;
+	as.v = this;
+	if (prog) {
+		prog->begin("Voxelizing triangles", added.size());
+	}
+	for (unsigned int i = 0; i < added.size(); ++i) {
+		if (prog) {
+			prog->add();
+		}
+
+		rasterize(g.place(mesh[added[i]]), this->w, this->h, this->d, as);
+	}
+
+	this->nRemoved = removed.size();
+	this->nAdded   = added.size();
+	this->textures.swap(nts);
+	this->tris.swap(nrs);
+}
+
+incremental::~incremental() {
+	free();
+}
+
+/*
+ * saved state
+ *
+ *   magic, version, max extent, bounds, key, dimensions, then texture records,
+ *   triangle records, and the sums of non-empty voxels (with their indexes)
+ */
+template <typename T>
+	void putRaw(std::ostream& out, const T& x) {
+		out.write((const char*)&x, sizeof(T));
+	}
+
+template <typename T>
+	bool getRaw(std::istream& in, T& x) {
+		return bool(in.read((char*)&x, sizeof(T)));
+	}
+
+void incremental::save(const std::string& stateFile) const {
+	std::string   tmp = stateFile + ".tmp";
+	std::ofstream out(tmp.c_str(), std::ios::binary);
+	if (!out) {
+		throw std::runtime_error("Unable to open the voxel state '" + tmp + "' for writing.");
+	}
+
+	out.write(stateMagic, sizeof(stateMagic));
+	putRaw(out, stateVersion);
+	putRaw(out, this->maxVoxExt);
+	putRaw(out, this->bounds);
+	putRaw(out, (unsigned int)this->key.size());
+	out.write(this->key.data(), this->key.size());
+	putRaw(out, this->w);
+	putRaw(out, this->h);
+	putRaw(out, this->d);
+
+	putRaw(out, (unsigned int)this->textures.size());
+	for (textureRecords::const_iterator t = this->textures.begin(); t != this->textures.end(); ++t) {
+		putRaw(out, t->hash);
+		putRaw(out, t->flat);
+		putRaw(out, t->kd);
+	}
+
+	putRaw(out, (unsigned int)this->tris.size());
+	for (triangleRecords::const_iterator t = this->tris.begin(); t != this->tris.end(); ++t) {
+		putRaw(out, t->hash);
+		putRaw(out, t->texture);
+		putRaw(out, t->ps);
+	}
+
+	unsigned int sz = this->w * this->h * this->d;
+	unsigned int n  = 0;
+	for (unsigned int i = 0; i < sz; ++i) {
+		n += (this->data[i] != 0) ? 1 : 0;
+	}
+	putRaw(out, n);
+	for (unsigned int i = 0; i < sz; ++i) {
+		if (this->data[i] != 0) {
+			putRaw(out, i);
+			putRaw(out, *this->data[i]);
+		}
+	}
+
+	out.close();
+	if (!out || rename(tmp.c_str(), stateFile.c_str()) != 0) {
+		remove(tmp.c_str());
+		throw std::runtime_error("Failed to write the voxel state '" + stateFile + "'.");
+	}
+}
+
+// (a missing or unreadable state just means starting over)
+bool incremental::load(const std::string& stateFile) {
+	std::ifstream in(stateFile.c_str(), std::ios::binary);
+	if (!in) {
+		return false;
+	}
+
+	char         magic[sizeof(stateMagic)];
+	unsigned int version = 0, kn = 0, n = 0;
+	if (!in.read(magic, sizeof(magic)) || memcmp(magic, stateMagic, sizeof(magic)) != 0 || !getRaw(in, version) || version != stateVersion) {
+		return false;
+	}
+
+	if (!getRaw(in, this->maxVoxExt) || !getRaw(in, this->bounds) || !getRaw(in, kn) || kn > 4096) {
+		return false;
+	}
+	this->key.resize(kn);
+	if ((kn > 0 && !in.read(&this->key[0], kn)) || !getRaw(in, this->w) || !getRaw(in, this->h) || !getRaw(in, this->d)) {
+		return false;
+	} else if (this->w == 0 || this->h == 0 || this->d == 0 || this->w > 4096 || this->h > 4096 || this->d > 4096 || (unsigned long long)this->w * this->h * this->d > (1ULL << 30)) {
+		return false;
+	}
+
+	if (!getRaw(in, n)) {
+		return false;
+	}
+	this->textures.resize(n);
+	for (unsigned int i = 0; i < n; ++i) {
+		textureRecord& t = this->textures[i];
+		if (!getRaw(in, t.hash) || !getRaw(in, t.flat) || !getRaw(in, t.kd)) {
+			reset();
+			return false;
+		}
+	}
+
+	if (!getRaw(in, n)) {
+		reset();
+		return false;
+	}
+	this->tris.resize(n);
+	for (unsigned int i = 0; i < n; ++i) {
+		triangleRecord& t = this->tris[i];
+		if (!getRaw(in, t.hash) || !getRaw(in, t.texture) || !getRaw(in, t.ps) || (t.texture != noTexture && t.texture >= this->textures.size())) {
+			reset();
+			return false;
+		}
+	}
+
+	alloc();
+	unsigned int sz = this->w * this->h * this->d;
+	if (!getRaw(in, n)) {
+		reset();
+		return false;
+	}
+	for (unsigned int i = 0; i < n; ++i) {
+		unsigned int j = 0;
+		colorSum     s;
+		if (!getRaw(in, j) || !getRaw(in, s) || j >= sz || s.n == 0 || this->data[j] != 0) {
+			reset();
+			return false;
+		}
+		this->data[j] = new colorSum(s);
+	}
+	return true;
+}
+
+bool   incremental::reused()  const { return this->isReused; }
+size_t incremental::added()   const { return this->nAdded; }
+size_t incremental::removed() const { return this->nRemoved; }
+
+const geom::volume& incremental::changes() const {
+	return this->mask;
+}
+
+unsigned int incremental::width()  const { return this->w; }
+unsigned int incremental::height() const { return this->h; }
+unsigned int incremental::depth()  const { return this->d; }
+
+// (voxels average their samples, just as triset voxels do)
+inline color::value average(const colorSum* s) {
+	double n = double(s->n);
+	return color::make(color::channel(double(s->r) / n), color::channel(double(s->g) / n), color::channel(double(s->b) / n), color::channel(double(s->a) / n));
+}
+
+color::value incremental::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	const colorSum* s = this->data[index(x, y, z)];
+	return s ? average(s) : color::make(0,0,0,0);
+}
+
+void incremental::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	colorSum* const* ss = this->data + index(x, y, z);
+	for (unsigned int i = 0; i < n; ++i) {
+		out[i] = ss[i] ? average(ss[i]) : color::make(0,0,0,0);
+	}
+}
+
+void incremental::rowSpans(unsigned int y, unsigned int z, geom::spans& out) const {
+	colorSum* const* ss = this->data + index(0, y, z);
+
+	out.clear();
+	for (unsigned int x = 0; x < this->w;) {
+		if (ss[x] == 0) {
+			++x;
+		} else {
+			unsigned int x0 = x;
+			while (x < this->w && ss[x] != 0) {
+				++x;
+			}
+			out.push_back(geom::span(x0, x - x0));
+		}
+	}
+}
+
+colorSum* incremental::cell(unsigned int x, unsigned int y, unsigned int z) {
+	unsigned int i = index(x, y, z);
+	colorSum* s = this->data[i];
+	if (s == 0) {
+		s = new colorSum();
+		this->data[i] = s;
+	}
+	return s;
+}
+
+unsigned int incremental::index(unsigned int x, unsigned int y, unsigned int z) const {
+	return x + (this->w * y) + (this->w * this->h * z);
+}
+
+void incremental::reset() {
+	free();
+	this->textures.clear();
+	this->tris.clear();
+}
+
+void incremental::alloc() {
+	unsigned int sz = this->w * this->h * this->d;
+	this->data = new colorSum*[sz];
+	for (unsigned int i = 0; i < sz; ++i) {
+		this->data[i] = 0;
+	}
+}
+
+void incremental::free() {
+	if (this->data != 0) {
+		unsigned int sz = this->w * this->h * this->d;
+		for (unsigned int i = 0; i < sz; ++i) {
+			delete this->data[i];
+		}
+		delete[] this->data;
+		this->data = 0;
+	}
+}
+
+colorSum::colorSum() : r(0), g(0), b(0), a(0), n(0) {
+}
+
+/*
+ * changeMask
+ */
+changeMask::changeMask(const incremental& v) : v(v) {
+}
+
+unsigned int changeMask::width()  const { return this->v.width(); }
+unsigned int changeMask::height() const { return this->v.height(); }
+unsigned int changeMask::depth()  const { return this->v.depth(); }
+
+color::value changeMask::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	if (this->v.allChanged || this->v.changed[this->v.index(x, y, z)]) {
+		return color::make(0xff, 0xff, 0xff);
+	} else {
+		return color::make(0,0,0,0);
+	}
+}
+
+}
+
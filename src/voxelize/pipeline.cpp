@@ -0,0 +1,116 @@
+
+#include <voxelize/pipeline.hpp>
+#include <obj/reader.hpp>
+#include <par/pool.hpp>
+#include <par/queue.hpp>
+#include <stdexcept>
+
+namespace voxelize {
+
+typedef std::vector<geom::triangle> faceBatch;
+
+// the number of face batches that can be read ahead of rasterization
+static const unsigned int queuedBatches = 16;
+
+// the grid over every vertex of a mesh
+inline grid meshGrid(unsigned int maxVoxExt, const std::string& objFile) {
+	geom::point lo(0, 0, 0), hi(0, 0, 0);
+	obj::vertexBounds(objFile, lo, hi);
+	return grid(maxVoxExt, aabb(lo.x, hi.x, lo.y, hi.y, lo.z, hi.z));
+}
+
+// the parsing stage (on its own thread) reads faces into the queue
+//   its reader owns the faces' textures, so it waits for rasterization to be done with them
+struct parseStage : public par::task, public obj::faceSink {
+	std::string            file;
+	par::queue<faceBatch>* batches;
+	const bool*            rasterized;
+	par::progress*         prog;
+
+	void faces(faceBatch& batch) {
+		if (!batches->push(batch)) {
+			throw std::runtime_error("Voxelization stopped before '" + this->file + "' was read.");
+		}
+	}
+
+	void finished() {
+		batches->close();
+
+		unsigned int tries = 0;
+		while (!__atomic_load_n(this->rasterized, __ATOMIC_ACQUIRE)) {
+			par::backoff(tries);
+		}
+	}
+
+	void run() {
+		obj::reader in(this->file, *this, this->prog);
+	}
+};
+
+pipeline::pipeline(unsigned int maxVoxExt, const std::string& objFile, par::progress* prog, const interiorFill& fill, colorResolution resolve) : g(meshGrid(maxVoxExt, objFile)), voxels(g, resolve) {
+	par::queue<faceBatch> batches(queuedBatches);
+	bool                  rasterized = false;
+
+	parseStage parse;
+	parse.file       = objFile;
+	parse.batches    = &batches;
+	parse.rasterized = &rasterized;
+	parse.prog       = prog;
+
+	par::pool  stage(1);
+	par::group parsing;
+	if (stage.size() == 0) {
+		throw std::runtime_error("Unable to start a thread to read '" + objFile + "'.");
+	}
+	stage.push(&parse, parsing);
+
+	// rasterize faces as they come (solids keep them, to find their insides once they're all in)
+	std::vector<geom::triangle> placed;
+	try {
+		faceBatch batch;
+		while (batches.pop(batch)) {
+			for (size_t i = 0; i < batch.size(); ++i) {
+				geom::triangle tri = this->g.place(batch[i]);
+				this->voxels.rasterize(tri);
+
+				if (fill.solid) {
+					placed.push_back(tri);
+				}
+			}
+		}
+	} catch (std::exception&) {
+		batches.close();
+		__atomic_store_n(&rasterized, true, __ATOMIC_RELEASE);
+		try {
+			stage.wait(parsing);
+		} catch (std::exception&) {
+		}
+		throw;
+	}
+
+	// (a failure to read the mesh is rethrown here)
+	__atomic_store_n(&rasterized, true, __ATOMIC_RELEASE);
+	stage.wait(parsing);
+
+	if (fill.solid) {
+		this->voxels.fillInterior(placed, fill, prog);
+	}
+}
+
+unsigned int pipeline::width()  const { return this->voxels.width(); }
+unsigned int pipeline::height() const { return this->voxels.height(); }
+unsigned int pipeline::depth()  const { return this->voxels.depth(); }
+
+color::value pipeline::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	return this->voxels.voxel(x, y, z);
+}
+
+void pipeline::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	this->voxels.readRow(x, y, z, n, out);
+}
+
+void pipeline::rowSpans(unsigned int y, unsigned int z, geom::spans& out) const {
+	this->voxels.rowSpans(y, z, out);
+}
+
+}
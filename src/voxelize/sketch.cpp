@@ -0,0 +1,68 @@
+
+#include <voxelize/sketch.hpp>
+#include <stdlib.h>
+
+namespace voxelize {
+
+// how far apart (in RGB, or in alpha) samples can be and still count as the same color
+static const double sameColorDistSq = 32.0 * 32.0;
+static const int    sameAlphaDist   = 64;
+
+inline bool sameColor(color::value a, color::value b) {
+	return color::distsq(a, b) <= sameColorDistSq && abs(int(color::alpha(a)) - int(color::alpha(b))) <= sameAlphaDist;
+}
+
+// move a mean toward a sample by 1/n
+inline color::channel towards(color::channel m, color::channel s, unsigned int n) {
+	return color::channel(int(m) + (int(s) - int(m)) / int(n));
+}
+
+sketch::sketch() {
+	for (unsigned int i = 0; i < k; ++i) {
+		this->means[i]  = 0;
+		this->counts[i] = 0;
+	}
+}
+
+void sketch::add(color::value c) {
+	// find the nearest slot of the same color (and the least counted slot, in case there isn't one)
+	unsigned int match = k;
+	unsigned int least = 0;
+	double       md    = 0.0;
+
+	for (unsigned int i = 0; i < k; ++i) {
+		if (this->counts[i] < this->counts[least]) {
+			least = i;
+		}
+		if (this->counts[i] > 0 && sameColor(this->means[i], c)) {
+			double di = color::distsq(this->means[i], c);
+			if (match == k || di < md) {
+				match = i;
+				md    = di;
+			}
+		}
+	}
+
+	if (match < k) {
+		unsigned int n = ++this->counts[match];
+		color::value m = this->means[match];
+		this->means[match] = color::make(towards(color::red(m), color::red(c), n), towards(color::green(m), color::green(c), n), towards(color::blue(m), color::blue(c), n), towards(color::alpha(m), color::alpha(c), n));
+	} else {
+		// a new color takes a free slot, or else replaces the least counted one (and inherits its count)
+		this->means[least] = c;
+		++this->counts[least];
+	}
+}
+
+color::value sketch::dominant() const {
+	unsigned int best = 0;
+	for (unsigned int i = 1; i < k; ++i) {
+		if (this->counts[i] > this->counts[best]) {
+			best = i;
+		}
+	}
+	return this->means[best];
+}
+
+}
+
@@ -0,0 +1,188 @@
+#include <voxelize/stack.hpp>
+#include <color/resize.hpp>
+#include <par/pool.hpp>
+#include <str/Util.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <dirent.h>
+
+namespace voxelize {
+
+// decode and shrink a batch of slices (each slice is only at full size inside its task)
+struct readSlices {
+	const std::vector<std::string>* files;
+	unsigned int                    first;
+	unsigned int                    sw, sh; // the size that every slice must be
+	unsigned int                    w, d;   // the size to shrink them to
+	std::vector<color::pixels>*     out;
+
+	void operator()(unsigned int i) {
+		const std::string& file = (*files)[this->first + i];
+
+		color::image img;
+		color::read(file, img);
+		if (img.width != this->sw || img.height != this->sh) {
+			throw std::runtime_error("The slice '" + file + "' is " + str::to_string(img.width) + "x" + str::to_string(img.height) + ", but earlier slices are " + str::to_string(this->sw) + "x" + str::to_string(this->sh) + ".");
+		}
+
+		color::pixels& ps = (*out)[i];
+		ps.resize(size_t(this->w) * this->d);
+		color::boxFilter(img, this->w, this->d, 0, this->d, &ps[0]);
+	}
+};
+
+// one slice of a batch, as a task (so that the next batch can decode while this one's summed)
+struct readSlice : public par::task {
+	readSlices*  f;
+	unsigned int i;
+
+	void run() {
+		(*f)(this->i);
+	}
+};
+
+// queue the batch of (up to) 'k' slices from 'first' to decode on the pool
+inline void startBatch(par::pool& p, readSlices& f, std::vector<readSlice>& ts, par::group& g, unsigned int first, unsigned int k) {
+	f.first = first;
+	for (unsigned int i = 0; i < k; ++i) {
+		ts[i].f = &f;
+		ts[i].i = i;
+		p.push(&ts[i], g);
+	}
+}
+
+stack::stack(unsigned int maxVoxExt, const std::string& directory, unsigned int sliceStep, par::progress* prog) : w(0), h(0), d(0) {
+	std::vector<std::string> files = slices(directory);
+	if (files.empty()) {
+		throw std::runtime_error("There are no slice images in '" + directory + "'.");
+	} else if (maxVoxExt == 0) {
+		return;
+	}
+
+	// the first slice determines the size of the volume's cross-section
+	color::image first;
+	color::read(files[0], first);
+
+	double pixelsPerVoxel = double(std::max(first.width, first.height)) / double(maxVoxExt);
+	this->w = std::max(1u, (unsigned int)(double(first.width)  / pixelsPerVoxel));
+	this->d = std::max(1u, (unsigned int)(double(first.height) / pixelsPerVoxel));
+
+	unsigned int n    = files.size();
+	unsigned int step = std::max(std::max(sliceStep, 1u), (n + maxVoxExt - 1) / maxVoxExt);
+	this->h = (n + step - 1) / step;
+
+	size_t layer = size_t(this->w) * this->d;
+	this->data.resize(layer * this->h);
+
+	readSlices f;
+	f.files = &files;
+	f.sw    = first.width;
+	f.sh    = first.height;
+	f.w     = this->w;
+	f.d     = this->d;
+	first.data.clear();
+
+	// read slices a batch at a time, summing each group of 'step' slices into a layer -- batches
+	// are double-buffered, so the pool decodes the next batch while this thread sums the last one
+	unsigned int               batch = par::threads();
+	par::pool&                 pool  = par::shared();
+	readSlices                 fs[2] = { f, f };
+	std::vector<color::pixels> decoded[2];
+	std::vector<readSlice>     tasks[2];
+	par::group                 decoding[2];
+	std::vector<unsigned long> sums(4 * layer, 0);
+
+	for (unsigned int b = 0; b < 2; ++b) {
+		decoded[b].resize(batch);
+		tasks[b].resize(batch);
+		fs[b].out = &decoded[b];
+	}
+
+	if (prog) {
+		prog->begin("Reading slices", n);
+	}
+	startBatch(pool, fs[0], tasks[0], decoding[0], 0, std::min(batch, n));
+
+	unsigned int cur = 0;
+	for (unsigned int first = 0; first < n; first += batch, cur = 1 - cur) {
+		unsigned int k    = std::min(batch, n - first);
+		unsigned int next = first + batch;
+
+		// (the next batch only starts once this one's in, so a failure never leaves tasks in flight)
+		pool.wait(decoding[cur]);
+		if (next < n) {
+			startBatch(pool, fs[1 - cur], tasks[1 - cur], decoding[1 - cur], next, std::min(batch, n - next));
+		}
+
+		for (unsigned int i = 0; i < k; ++i) {
+			unsigned int         s  = first + i;
+			const color::pixels& ps = decoded[cur][i];
+
+			for (size_t p = 0; p < layer; ++p) {
+				sums[4 * p + 0] += color::red  (ps[p]);
+				sums[4 * p + 1] += color::green(ps[p]);
+				sums[4 * p + 2] += color::blue (ps[p]);
+				sums[4 * p + 3] += color::alpha(ps[p]);
+			}
+
+			// finish this layer once all of its slices have been read
+			if ((s + 1) % step == 0 || s + 1 == n) {
+				unsigned long c   = s % step + 1;
+				color::value* out = &this->data[layer * (s / step)];
+
+				for (size_t p = 0; p < layer; ++p) {
+					out[p] = color::make(color::channel(sums[4 * p] / c), color::channel(sums[4 * p + 1] / c), color::channel(sums[4 * p + 2] / c), color::channel(sums[4 * p + 3] / c));
+				}
+				std::fill(sums.begin(), sums.end(), 0);
+			}
+		}
+		if (prog) {
+			prog->add(k);
+		}
+	}
+}
+
+unsigned int stack::width()  const { return this->w; }
+unsigned int stack::height() const { return this->h; }
+unsigned int stack::depth()  const { return this->d; }
+
+color::value stack::voxel(unsigned int x, unsigned int y, unsigned int z) const {
+	if (x >= this->w || y >= this->h || z >= this->d) {
+		return color::make(0x00, 0x00, 0x00, 0x00);
+	} else {
+		return this->data[(size_t(y) * this->d + z) * this->w + x];
+	}
+}
+
+void stack::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	geom::readDenseRow(this->data.empty() ? 0 : &this->data[0], this->w, this->h, this->d, x, y, z, n, out);
+}
+
+std::vector<std::string> stack::slices(const std::string& directory) {
+	static const char* exts[] = { "png", "tga", "ppm", "pgm", "pnm", "bmp", "gif", "jpg", "jpeg", "tif", "tiff" };
+
+	DIR* dir = opendir(directory.c_str());
+	if (dir == 0) {
+		throw std::runtime_error("Unable to open the slice directory '" + directory + "'.");
+	}
+
+	std::vector<std::string> result;
+	while (dirent* e = readdir(dir)) {
+		std::string name = e->d_name;
+		std::string ext  = str::lcase(str::rsplit<char>(name, ".").second);
+
+		for (unsigned int i = 0; i < sizeof(exts) / sizeof(exts[0]); ++i) {
+			if (ext == exts[i] && name[0] != '.') {
+				result.push_back(directory + "/" + name);
+				break;
+			}
+		}
+	}
+	closedir(dir);
+
+	std::sort(result.begin(), result.end());
+	return result;
+}
+
+}
+
@@ -1,126 +1,347 @@
 
 #include <voxelize/triset.hpp>
-#include <geom/line.hpp>
+#include <voxelize/raster.hpp>
+#include <geom/bvh.hpp>
+#include <par/pool.hpp>
+#include <algorithm>
+#include <math.h>
 #include <iostream>
 
 namespace voxelize {
 
-inline void putVoxel(colors* c, color::value x) {
-	c->push_back(x);
-}
+// samples just go into the list of colors (or the sketch) at each voxel
+struct putVoxels {
+	triset* v;
+
+	void put(unsigned int x, unsigned int y, unsigned int z, color::value c) {
+		v->add(x, y, z, c);
+	}
+};
 
-// rasterize a 3D triangle (in bounds-space) to our voxel grid
 void triset::rasterize(const geom::triangle& tri) {
-	double ls0[] = { tri.p0.x, tri.p0.y, tri.p0.z, tri.p0.u, tri.p0.v, /**/ tri.p1.x, tri.p1.y, tri.p1.z, tri.p1.u, tri.p1.v };
-	double ls1[] = { tri.p2.x, tri.p2.y, tri.p2.z, tri.p2.u, tri.p2.v, /**/ tri.p2.x, tri.p2.y, tri.p2.z, tri.p2.u, tri.p2.v };
-
-	// now triangulate
-	geom::line<10> area(ls0, ls1);
-	while (!area.done()) {
-		const double* ln = area.point();
-
-		double x0 = ln[0];
-		double y0 = ln[1];
-		double z0 = ln[2];
-		double u0 = ln[3];
-		double v0 = ln[4];
-		double p0[] = { x0, y0, z0, u0, v0 };
-
-		double x1 = ln[5];
-		double y1 = ln[6];
-		double z1 = ln[7];
-		double u1 = ln[8];
-		double v1 = ln[9];
-		double p1[] = { x1, y1, z1, u1, v1 };
-
-		geom::line<5> line(p0, p1);
-		while (!line.done()) {
-			const double* pt = line.point();
-			
-			double x = pt[0];
-			double y = pt[1];
-			double z = pt[2];
-			double u = pt[3];
-			double v = pt[4];
-
-			if (isnan(x)) { x = 0; }
-			if (isnan(y)) { y = 0; }
-			if (isnan(z)) { z = 0; }
-
-			int pxs[] = { int(floor(x)), int(ceil(x)) };
-			int pys[] = { int(floor(y)), int(ceil(y)) };
-			int pzs[] = { int(floor(z)), int(ceil(z)) };
-			color::value c = tri.color(u, v);
-
-			for (int xi = 0; xi < 2; ++xi) {
-				for (int yi = 0; yi < 2; ++yi) {
-					for (int zi = 0; zi < 2; ++zi) {
-						int vx = std::min<int>(pxs[xi], width()  - 1);
-						int vy = std::min<int>(pys[yi], height() - 1);
-						int vz = std::min<int>(pzs[zi], depth()  - 1);
-
-						putVoxel(cell(vx, vy, vz), c);
+	putVoxels out;
+	out.v = this;
+	voxelize::rasterize(tri, width(), height(), depth(), out);
+}
+
+// the basic triset/volume wrapper
+triset::triset(unsigned int maxVoxExt, const geom::triset& tris, par::progress* prog, const interiorFill& fill, colorResolution resolve) {
+	grid g(maxVoxExt, aabb(tris.minX(), tris.maxX(), tris.minY(), tris.maxY(), tris.minZ(), tris.maxZ()));
+	this->w = g.w;
+	this->h = g.h;
+	this->d = g.d;
+	alloc(resolve);
+
+	// (solid volumes keep triangles around to find where columns cross them)
+	std::vector<geom::triangle> vtris;
+	if (fill.solid) {
+		vtris.reserve(tris.size());
+	}
+
+	size_t n = tris.size();
+	if (prog) {
+		prog->begin("Voxelizing triangles", n);
+	}
+	for (unsigned int i = 0; i < n; ++i) {
+		if (prog) {
+			prog->add();
+		}
+
+		// convert this triangle into voxel volume coordinates
+		geom::triangle tri = g.place(tris[i]);
+
+		// put voxels on this surface into the voxel volume
+		rasterize(tri);
+
+		if (fill.solid) {
+			vtris.push_back(tri);
+		}
+	}
+
+	if (fill.solid) {
+		fillInterior(vtris, fill, prog);
+	}
+}
+
+triset::triset(const grid& g, colorResolution resolve) : w(g.w), h(g.h), d(g.d) {
+	alloc(resolve);
+}
+
+/*
+ * solid interiors
+ *
+ *   every (x, z) column is crossed with the triangles over it, and voxels between
+ *   alternate pairs of crossings are inside -- columns are sampled just off of the
+ *   voxel grid, so that they never pass exactly through a (grid-aligned) vertex or edge
+ */
+static const double columnOffsetX = 0.000123;
+static const double columnOffsetZ = 0.000217;
+
+// the height where a column crosses a triangle (if it does)
+inline bool crossing(const geom::triangle& t, double px, double pz, double* y) {
+	double d = (t.p1.x - t.p0.x) * (t.p2.z - t.p0.z) - (t.p2.x - t.p0.x) * (t.p1.z - t.p0.z);
+	if (fabs(d) < 1e-12) {
+		return false; // edge-on to the column
+	}
+
+	double l1 = ((px - t.p0.x) * (t.p2.z - t.p0.z) - (t.p2.x - t.p0.x) * (pz - t.p0.z)) / d;
+	double l2 = ((t.p1.x - t.p0.x) * (pz - t.p0.z) - (px - t.p0.x) * (t.p1.z - t.p0.z)) / d;
+	double l0 = 1.0 - l1 - l2;
+	if (l0 < 0.0 || l1 < 0.0 || l2 < 0.0) {
+		return false;
+	}
+
+	*y = (l0 * t.p0.y) + (l1 * t.p1.y) + (l2 * t.p2.y);
+	return true;
+}
+
+// the index range [i0, i1] of grid points (offset by o) within [lo, hi], clipped to [0, n)
+inline bool gridRange(double lo, double hi, double o, unsigned int n, int& i0, int& i1) {
+	i0 = std::max(0, int(ceil(lo - o)));
+	i1 = std::min(int(n) - 1, int(floor(hi - o)));
+	return i0 <= i1;
+}
+
+// fill the columns of one z row (each row only writes its own columns)
+struct fillRows {
+	triset*                                         v;
+	const std::vector<geom::triangle>*              tris;
+	const std::vector< std::vector<unsigned int> >* rows;
+	const interiorFill*                             fill;
+	par::progress*                                  prog;
+
+	void operator()(unsigned int z) {
+		unsigned int w  = v->width();
+		unsigned int h  = v->height();
+		double       pz = double(z) + columnOffsetZ;
+
+		// find every crossing in this row
+		std::vector< std::vector<double> > hits(w);
+		const std::vector<unsigned int>&   ts = (*rows)[z];
+
+		for (unsigned int i = 0; i < ts.size(); ++i) {
+			const geom::triangle& t = (*tris)[ts[i]];
+
+			int x0, x1;
+			if (!gridRange(std::min(t.p0.x, std::min(t.p1.x, t.p2.x)), std::max(t.p0.x, std::max(t.p1.x, t.p2.x)), columnOffsetX, w, x0, x1)) {
+				continue;
+			}
+
+			for (int x = x0; x <= x1; ++x) {
+				double y = 0.0;
+				if (crossing(t, double(x) + columnOffsetX, pz, &y)) {
+					hits[x].push_back(y);
+				}
+			}
+		}
+
+		// and fill between them (an unpaired last crossing means the mesh isn't closed here, so it's ignored)
+		for (unsigned int x = 0; x < w; ++x) {
+			std::vector<double>& ys = hits[x];
+			std::sort(ys.begin(), ys.end());
+
+			for (unsigned int i = 0; i + 1 < ys.size(); i += 2) {
+				int a = std::max(0, int(ceil(ys[i])));
+				int b = std::min(int(h) - 1, int(floor(ys[i + 1])));
+				if (a <= b) {
+					v->addInteriorRun(x, z, a, b, *fill);
+				}
+			}
+		}
+
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+};
+
+// decide which voxels are inside a brick column at a time -- bricks that no triangle
+// comes near are wholly inside or outside, so only need one winding number
+static const unsigned int brickSize = 8;
+
+struct windColumns {
+	triset*             v;
+	const geom::bvh*    tree;
+	const interiorFill* fill;
+	par::progress*      prog;
+
+	void operator()(unsigned int i) {
+		unsigned int w  = v->width();
+		unsigned int h  = v->height();
+		unsigned int d  = v->depth();
+		unsigned int bw = (w + brickSize - 1) / brickSize;
+		unsigned int x0 = (i % bw) * brickSize, x1 = std::min(w, x0 + brickSize);
+		unsigned int z0 = (i / bw) * brickSize, z1 = std::min(d, z0 + brickSize);
+
+		// inside[(x - x0) + brickSize * (z - z0)][y]
+		std::vector< std::vector<bool> > inside(brickSize * brickSize, std::vector<bool>(h, false));
+
+		for (unsigned int y0 = 0; y0 < h; y0 += brickSize) {
+			unsigned int y1 = std::min(h, y0 + brickSize);
+
+			// (voxel centers are at integer coordinates)
+			geom::box bb(double(x0) - 1.0, double(y0) - 1.0, double(z0) - 1.0, double(x1), double(y1), double(z1));
+			if (!tree->overlaps(bb)) {
+				double c = tree->winding(0.5 * (x0 + x1 - 1), 0.5 * (y0 + y1 - 1), 0.5 * (z0 + z1 - 1));
+				if (fabs(c) > 0.5) {
+					for (unsigned int z = z0; z < z1; ++z) {
+						for (unsigned int x = x0; x < x1; ++x) {
+							std::vector<bool>& col = inside[(x - x0) + brickSize * (z - z0)];
+							std::fill(col.begin() + y0, col.begin() + y1, true);
+						}
 					}
 				}
+				continue;
 			}
 
-			++line;
+			for (unsigned int z = z0; z < z1; ++z) {
+				for (unsigned int x = x0; x < x1; ++x) {
+					std::vector<bool>& col = inside[(x - x0) + brickSize * (z - z0)];
+					// the winding number only jumps where the column crosses the surface, which is
+					// always inside a surface voxel -- so each gap between them needs just one test
+					for (unsigned int y = y0; y < y1;) {
+						if (v->hit(v->index(x, y, z))) {
+							col[y++] = true; // (surface voxels are drawn anyway)
+							continue;
+						}
+
+						unsigned int g = y;
+						while (g < y1 && !v->hit(v->index(x, g, z))) {
+							++g;
+						}
+
+						bool in = fabs(tree->winding(x, 0.5 * (y + g - 1), z)) > 0.5;
+						for (; y < g; ++y) {
+							col[y] = in;
+						}
+					}
+				}
+			}
 		}
 
-		++area;
+		// then turn each column into runs
+		for (unsigned int z = z0; z < z1; ++z) {
+			for (unsigned int x = x0; x < x1; ++x) {
+				const std::vector<bool>& col = inside[(x - x0) + brickSize * (z - z0)];
+				for (unsigned int y = 0; y < h;) {
+					if (!col[y]) {
+						++y;
+					} else {
+						unsigned int a = y;
+						while (y < h && col[y]) {
+							++y;
+						}
+						v->addInteriorRun(x, z, a, y - 1, *fill);
+					}
+				}
+			}
+		}
+
+		if (this->prog) {
+			this->prog->add();
+		}
+	}
+};
+
+// add interior voxels [y0, y1] to a column (the lower half of the run takes the color
+// of the nearest surface below it, and the upper half the nearest surface above it)
+void triset::addInteriorRun(unsigned int x, unsigned int z, int y0, int y1, const interiorFill& fill) {
+	fillRuns& rs = this->interior[x + width() * z];
+
+	if (fill.useColor) {
+		rs.push_back(fillRun(y0, y1 + 1, fill.color));
+		return;
+	}
+
+	int below = y0;
+	int above = y1;
+	while (below >= 0 && !hit(index(x, below, z))) {
+		--below;
+	}
+	while (above < int(height()) && !hit(index(x, above, z))) {
+		++above;
+	}
+	bool hasBelow = below >= 0;
+	bool hasAbove = above < int(height());
+
+	color::value cb = hasBelow ? resolved(index(x, below, z)) : (hasAbove ? resolved(index(x, above, z)) : fill.color);
+	color::value ca = hasAbove ? resolved(index(x, above, z)) : cb;
+	int          m  = (y0 + y1 + 1) / 2;
+
+	if (m > y0) {
+		rs.push_back(fillRun(y0, m, cb));
 	}
+	rs.push_back(fillRun(m, y1 + 1, ca));
 }
 
-// the basic triset/volume wrapper
-triset::triset(unsigned int maxVoxExt, const geom::triset& tris, PROGRESSFN pfn) {
-	aabb bounds(tris.minX(), tris.maxX(), tris.minY(), tris.maxY(), tris.minZ(), tris.maxZ());
+void triset::fillInterior(const std::vector<geom::triangle>& tris, const interiorFill& fill, par::progress* prog) {
+	this->interior.assign(size_t(width()) * depth(), fillRuns());
 
-	initVolume(maxVoxExt, bounds.width(), bounds.height(), bounds.depth());
-	alloc();
+	if (fill.winding) {
+		geom::bvh    tree(tris);
+		unsigned int n = ((width() + brickSize - 1) / brickSize) * ((depth() + brickSize - 1) / brickSize);
 
-	// allow triangle coordinates to be normalized to voxel space
-	geom::point to = geom::point(bounds.x0, bounds.y0, bounds.z0);
-	double      sx = double(width() - 1) / bounds.width();
-	double      sy = double(height() - 1) / bounds.height();
-	double      sz = double(depth() - 1) / bounds.depth();
+		if (prog) {
+			prog->begin("Filling interior", n);
+		}
 
-	size_t n = tris.size();
-	for (unsigned int i = 0; i < n; ++i) {
-		if (pfn) {
-			pfn("Voxelizing triangle", i, n);
+		windColumns f;
+		f.v    = this;
+		f.tree = &tree;
+		f.fill = &fill;
+		f.prog = prog;
+		par::each(n, f);
+		return;
+	}
+
+	if (prog) {
+		prog->begin("Filling interior", depth());
+	}
+
+	// sort triangles into the z rows of columns that they span
+	std::vector< std::vector<unsigned int> > rows(depth());
+	for (unsigned int i = 0; i < tris.size(); ++i) {
+		const geom::triangle& t = tris[i];
+
+		int z0, z1;
+		if (gridRange(std::min(t.p0.z, std::min(t.p1.z, t.p2.z)), std::max(t.p0.z, std::max(t.p1.z, t.p2.z)), columnOffsetZ, depth(), z0, z1)) {
+			for (int z = z0; z <= z1; ++z) {
+				rows[z].push_back(i);
+			}
 		}
+	}
 
-		// convert this triangle into voxel volume coordinates
-		geom::triangle tri = tris[i] - to;
-		tri.scale(sx, sy, sz);
+	fillRows f;
+	f.v    = this;
+	f.tris = &tris;
+	f.rows = &rows;
+	f.fill = &fill;
+	f.prog = prog;
+	par::each(depth(), f);
+}
 
-		// put voxels on this surface into the voxel volume
-		rasterize(tri);
+const fillRun* triset::interiorAt(unsigned int x, unsigned int y, unsigned int z) const {
+	if (this->interior.empty()) {
+		return 0;
+	}
+
+	const fillRuns& rs = this->interior[x + width() * z];
+	for (fillRuns::const_iterator r = rs.begin(); r != rs.end(); ++r) {
+		if (r->y0 <= y && y < r->y1) {
+			return &(*r);
+		}
 	}
+	return 0;
 }
 
-triset::~triset() {
-	free();
+interiorFill::interiorFill() : solid(false), winding(false), useColor(false), color(color::make(0xaaaaaa)) {
 }
 
-void triset::initVolume(unsigned int maxVoxExt, double cx, double cy, double cz) {
-	if (cx > cy && cx > cz) {
-		this->w = maxVoxExt;
-		this->h = (unsigned int)(double(maxVoxExt) * (cy / cx));
-		this->d = (unsigned int)(double(maxVoxExt) * (cz / cx));
-	} else if (cz > cy) {
-		this->d = maxVoxExt;
-		this->w = (unsigned int)(double(maxVoxExt) * (cx / cz));
-		this->h = (unsigned int)(double(maxVoxExt) * (cy / cz));
-	} else {
-		this->h = maxVoxExt;
-		this->d = (unsigned int)(double(maxVoxExt) * (cz / cy));
-		this->w = (unsigned int)(double(maxVoxExt) * (cx / cy));
-	}
+fillRun::fillRun(unsigned int y0, unsigned int y1, color::value c) : y0(y0), y1(y1), c(c) {
+}
 
-	if (this->w <= 1) { this->w = 1; }
-	if (this->h <= 1) { this->h = 1; }
-	if (this->d <= 1) { this->d = 1; }
+triset::~triset() {
+	free();
 }
 
 unsigned int triset::width()  const { return this->w; }
@@ -128,43 +349,99 @@ unsigned int triset::height() const { return this->h; }
 unsigned int triset::depth()  const { return this->d; }
 
 color::value triset::voxel(unsigned int x, unsigned int y, unsigned int z) const {
-	const colors* cs = lookup(x, y, z);
-	if (cs == 0) {
-		return color::make(0,0,0,0);
+	unsigned int i = index(x, y, z);
+	if (!hit(i)) {
+		const fillRun* r = interiorAt(x, y, z);
+		return r ? r->c : color::make(0,0,0,0);
 	} else {
-		return color::average(*cs);
+		return resolved(i);
+	}
+}
+
+// (rows are contiguous along x, and only cells that were hit need resolving)
+void triset::readRow(unsigned int x, unsigned int y, unsigned int z, unsigned int n, color::value* out) const {
+	unsigned int i0 = index(x, y, z);
+	for (unsigned int i = 0; i < n; ++i) {
+		if (hit(i0 + i)) {
+			out[i] = resolved(i0 + i);
+		} else {
+			const fillRun* r = interiorAt(x + i, y, z);
+			out[i] = r ? r->c : color::make(0,0,0,0);
+		}
+	}
+}
+
+void triset::rowSpans(unsigned int y, unsigned int z, geom::spans& out) const {
+	unsigned int i0 = index(0, y, z);
+	unsigned int w  = width();
+
+	out.clear();
+	for (unsigned int x = 0; x < w;) {
+		if (!hit(i0 + x) && interiorAt(x, y, z) == 0) {
+			++x;
+		} else {
+			unsigned int x0 = x;
+			while (x < w && (hit(i0 + x) || interiorAt(x, y, z) != 0)) {
+				++x;
+			}
+			out.push_back(geom::span(x0, x - x0));
+		}
 	}
 }
 
-const colors* triset::lookup(unsigned int x, unsigned int y, unsigned int z) const {
-	return this->data[index(x, y, z)];
+bool triset::hit(unsigned int i) const {
+	return this->data ? this->data[i] != 0 : this->sketched[i] != 0;
+}
+
+color::value triset::resolved(unsigned int i) const {
+	return this->data ? color::average(*this->data[i]) : this->sketches[this->sketched[i] - 1].dominant();
 }
 
-colors* triset::cell(unsigned int x, unsigned int y, unsigned int z) {
+void triset::add(unsigned int x, unsigned int y, unsigned int z, color::value c) {
 	unsigned int i = index(x, y, z);
-	colors* c = this->data[i];
-	if (c == 0) {
-		c = new colors();
-		this->data[i] = c;
+	if (this->data) {
+		if (this->data[i] == 0) {
+			this->data[i] = new colors();
+		}
+		this->data[i]->push_back(c);
+	} else {
+		if (this->sketched[i] == 0) {
+			this->sketches.push_back(sketch());
+			this->sketched[i] = (unsigned int)this->sketches.size();
+		}
+		this->sketches[this->sketched[i] - 1].add(c);
 	}
-	return c;
 }
 
 unsigned int triset::index(unsigned int x, unsigned int y, unsigned int z) const {
 	return x + (width() * y) + (width() * height() * z);
 }
 
-void triset::alloc() {
+void triset::alloc(colorResolution resolve) {
 	unsigned int sz = width() * height() * depth();
-	this->data = new colors*[sz];
-	for (unsigned int i = 0; i < sz; ++i) {
-		this->data[i] = 0;
+	this->data = 0;
+
+	if (resolve == dominantColors) {
+		this->sketched.assign(sz, 0);
+	} else {
+		this->data = new colors*[sz];
+		for (unsigned int i = 0; i < sz; ++i) {
+			this->data[i] = 0;
+		}
 	}
 }
 
 void triset::free() {
-	delete[] this->data;
-	this->data = 0;
+	unsigned int sz = width() * height() * depth();
+	if (this->data != 0) {
+		for (unsigned int i = 0; i < sz; ++i) {
+			delete this->data[i];
+		}
+		delete[] this->data;
+		this->data = 0;
+	}
+	std::vector<sketch>().swap(this->sketches);
+	std::vector<unsigned int>().swap(this->sketched);
 }
 
 // an axis-aligned bounding box in 3D space
@@ -175,5 +452,41 @@ double aabb::width()  const { return this->x1 - this->x0; }
 double aabb::height() const { return this->y1 - this->y0; }
 double aabb::depth()  const { return this->z1 - this->z0; }
 
+// the voxel grid spanning some bounds (the longest side gets the max extent, and the others are scaled to match)
+grid::grid(unsigned int maxVoxExt, const aabb& bounds) : to(bounds.x0, bounds.y0, bounds.z0) {
+	double cx = bounds.width();
+	double cy = bounds.height();
+	double cz = bounds.depth();
+
+	if (cx > cy && cx > cz) {
+		this->w = maxVoxExt;
+		this->h = (unsigned int)(double(maxVoxExt) * (cy / cx));
+		this->d = (unsigned int)(double(maxVoxExt) * (cz / cx));
+	} else if (cz > cy) {
+		this->d = maxVoxExt;
+		this->w = (unsigned int)(double(maxVoxExt) * (cx / cz));
+		this->h = (unsigned int)(double(maxVoxExt) * (cy / cz));
+	} else {
+		this->h = maxVoxExt;
+		this->d = (unsigned int)(double(maxVoxExt) * (cz / cy));
+		this->w = (unsigned int)(double(maxVoxExt) * (cx / cy));
+	}
+
+	if (this->w <= 1) { this->w = 1; }
+	if (this->h <= 1) { this->h = 1; }
+	if (this->d <= 1) { this->d = 1; }
+
+	// allow triangle coordinates to be normalized to voxel space
+	this->sx = double(this->w - 1) / cx;
+	this->sy = double(this->h - 1) / cy;
+	this->sz = double(this->d - 1) / cz;
+}
+
+geom::triangle grid::place(const geom::triangle& t) const {
+	geom::triangle r = t - this->to;
+	r.scale(this->sx, this->sy, this->sz);
+	return r;
+}
+
 }
 